@@ -0,0 +1,381 @@
+#include "Cache.h"
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CACHE_X86_SIMD 1
+#endif
+using namespace std;
+
+//
+// Tag matching. Invalid ways hold INVALID_TAG, so every implementation is a pure equality
+// search over the packed per-set tag array; at most one way can match. Tags are 64 bits: SSE2
+// has no 64-bit compare, so it compares the 32-bit halves and ANDs each with its neighbour.
+//
+static int matchTagScalar(const uint64_t* setTags, int ways, uint64_t tag) {
+    for (int way = 0; way < ways; way++) {
+        if (setTags[way] == tag) {
+            return way;
+        }
+    }
+    return -1;
+}
+
+#ifdef CACHE_X86_SIMD
+static inline __m128i cmpeq64SSE2(__m128i a, __m128i b) {
+    __m128i eq = _mm_cmpeq_epi32(a, b);
+    return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+static int matchTagSSE2(const uint64_t* setTags, int ways, uint64_t tag) {
+    const __m128i key = _mm_set1_epi64x((long long)tag);
+    int way = 0;
+    for (; way + 2 <= ways; way += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(setTags + way));
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(cmpeq64SSE2(v, key)));
+        if (mask) {
+            return way + __builtin_ctz(mask);
+        }
+    }
+    int rest = matchTagScalar(setTags + way, ways - way, tag);
+    return (rest < 0) ? -1 : way + rest;
+}
+
+__attribute__((target("avx2")))
+static int matchTagAVX2(const uint64_t* setTags, int ways, uint64_t tag) {
+    const __m256i key = _mm256_set1_epi64x((long long)tag);
+    int way = 0;
+    for (; way + 4 <= ways; way += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(setTags + way));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, key)));
+        if (mask) {
+            return way + __builtin_ctz(mask);
+        }
+    }
+    // Clear the upper YMM halves before running non-VEX code, or every SSE instruction
+    // after this call pays the AVX/SSE transition penalty
+    _mm256_zeroupper();
+    int rest = matchTagScalar(setTags + way, ways - way, tag);
+    return (rest < 0) ? -1 : way + rest;
+}
+#endif
+
+static TagMatchFn tagMatchFunction(TagMatchKind kind) {
+#ifdef CACHE_X86_SIMD
+    if (kind == TAG_MATCH_AVX2) return matchTagAVX2;
+    if (kind == TAG_MATCH_SSE2) return matchTagSSE2;
+#endif
+    (void)kind;
+    return matchTagScalar;
+}
+
+int matchTag(TagMatchKind kind, const uint64_t* setTags, int ways, uint64_t tag) {
+    return tagMatchFunction(kind)(setTags, ways, tag);
+}
+
+// The widest search a set fills: an AVX2 vector holds 4 tags, an SSE2 one 2
+TagMatchKind bestTagMatch(int ways) {
+#ifdef CACHE_X86_SIMD
+    if (ways >= 4 && __builtin_cpu_supports("avx2")) return TAG_MATCH_AVX2;
+    if (ways >= 2) return TAG_MATCH_SSE2; // always present on x86-64
+#endif
+    (void)ways;
+    return TAG_MATCH_SCALAR;
+}
+
+const char* tagMatchName(TagMatchKind kind) {
+    switch (kind) {
+        case TAG_MATCH_AVX2: return "AVX2";
+        case TAG_MATCH_SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+//
+// Compile-time geometries. With E and b fixed the block shift, the set stride and the way
+// loop are constants: lookups compile to a shift, an AND with the set mask and a fully
+// unrolled compare (branch-free SSE2 when E is even).
+//
+template <int E>
+static inline int matchTagFixed(const uint64_t* setTags, uint64_t tag) {
+#ifdef CACHE_X86_SIMD
+    if (E % 2 == 0) {
+        const __m128i key = _mm_set1_epi64x((long long)tag);
+        unsigned int mask = 0;
+        for (int i = 0; i < E / 2; i++) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(setTags + 2 * i));
+            mask |= (unsigned int)_mm_movemask_pd(_mm_castsi128_pd(cmpeq64SSE2(v, key))) << (2 * i);
+        }
+        return mask ? __builtin_ctz(mask) : -1;
+    }
+#endif
+    for (int way = 0; way < E; way++) {
+        if (setTags[way] == tag) {
+            return way;
+        }
+    }
+    return -1;
+}
+
+template <int E, int B>
+int Cache::findLineFixed(const Cache* cache, uint64_t address) {
+    uint64_t block = address >> B;
+    unsigned int setIndex = (unsigned int)(block & cache->setMask);
+    int way = matchTagFixed<E>(cache->tags + (size_t)setIndex * E, block);
+    return (way < 0) ? -1 : (int)(setIndex * E) + way;
+}
+
+int Cache::findLineGeneric(const Cache* cache, uint64_t address) {
+    unsigned int setIndex = cache->getSetIndex(address);
+    int way = cache->findLineInSet(setIndex, cache->getTag(address));
+    return (way < 0) ? -1 : (int)setIndex * cache->associativity + way;
+}
+
+// Geometries built as specializations; extend this table to add more
+#define CACHE_GEOMETRY(E, B) { E, B, &Cache::findLineFixed<E, B> }
+
+Cache::FindLineFn Cache::specializedFindLine(int E, int b) {
+    struct Geometry { int ways; int blockBits; FindLineFn fn; };
+    static const Geometry table[] = {
+        CACHE_GEOMETRY(1, 5), CACHE_GEOMETRY(2, 5), CACHE_GEOMETRY(4, 5), CACHE_GEOMETRY(8, 5), CACHE_GEOMETRY(16, 5),
+        CACHE_GEOMETRY(1, 6), CACHE_GEOMETRY(2, 6), CACHE_GEOMETRY(4, 6), CACHE_GEOMETRY(8, 6), CACHE_GEOMETRY(16, 6),
+    };
+    for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++) {
+        if (table[i].ways == E && table[i].blockBits == b) {
+            return table[i].fn;
+        }
+    }
+    return &Cache::findLineGeneric;
+}
+
+#undef CACHE_GEOMETRY
+
+static size_t alignUp(size_t n, size_t alignment) {
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+Cache::Cache(int coreId, int s, int E, int b, bool withData, ReplacementPolicy policy)
+    : coreId(coreId), numSets(1 << s), associativity(E), blockSize(1 << b),
+      blockOffsetBits(b), setIndexBits(s), tagBits(64 - s - b), waysLog2(0), policy(policy),
+      useClock(policy == REPLACEMENT_LRU ? 0 : (uint64_t)(coreId + 1) * 0x9e3779b97f4a7c15ull),
+      tagMatch(tagMatchFunction(bestTagMatch(E))), setMask((uint64_t)(numSets - 1)),
+      findLineFn(specializedFindLine(E, b)) {
+#ifdef L1SIM_REPLACEMENT
+    if (policy != L1SIM_REPLACEMENT) {
+        throw invalid_argument(string("this build supports only ") + replacementPolicyName(L1SIM_REPLACEMENT) +
+                               " replacement");
+    }
+#endif
+    if (policy == REPLACEMENT_PLRU) {
+        if (E > 64 || (E & (E - 1)) != 0) {
+            throw invalid_argument("tree-PLRU replacement needs a power-of-two associativity of at most 64");
+        }
+        while ((1 << waysLog2) < E) waysLog2++;
+    }
+
+    // Arena layout: tags | replacement metadata | states | payload (64-byte aligned)
+    size_t numLines = (size_t)numSets * associativity;
+    size_t metaBytes = 0;
+    switch (policy) {
+        case REPLACEMENT_LRU: metaBytes = numLines * sizeof(uint64_t); break;
+        case REPLACEMENT_PLRU: metaBytes = (size_t)numSets * sizeof(uint64_t); break;
+        case REPLACEMENT_SRRIP:
+        case REPLACEMENT_BRRIP: metaBytes = numLines; break;
+        case REPLACEMENT_RANDOM: break;
+    }
+    size_t metaOffset = numLines * sizeof(uint64_t);
+    size_t stateOffset = metaOffset + metaBytes;
+    size_t dataOffset = alignUp(stateOffset + numLines, 64);
+    arenaSize = withData ? dataOffset + numLines * blockSize : stateOffset + numLines;
+    arena.reset(new unsigned char[arenaSize]);
+
+    tags = reinterpret_cast<uint64_t*>(arena.get());
+    lastUsed = (policy == REPLACEMENT_LRU) ? reinterpret_cast<uint64_t*>(arena.get() + metaOffset) : nullptr;
+    plruBits = (policy == REPLACEMENT_PLRU) ? reinterpret_cast<uint64_t*>(arena.get() + metaOffset) : nullptr;
+    rrpv = (policy == REPLACEMENT_SRRIP || policy == REPLACEMENT_BRRIP) ? arena.get() + metaOffset : nullptr;
+    states = arena.get() + stateOffset;
+    data = withData ? arena.get() + dataOffset : nullptr;
+
+    std::fill(tags, tags + numLines, INVALID_TAG);
+    std::fill(arena.get() + metaOffset, arena.get() + stateOffset, (unsigned char)0);
+    if (rrpv) {
+        std::fill(rrpv, rrpv + numLines, RRPV_MAX);
+    }
+    std::fill(states, states + numLines, (unsigned char)INVALID);
+    if (data) {
+        std::fill(data, data + numLines * blockSize, (unsigned char)0);
+    }
+}
+
+CacheLine Cache::getLine(int slot) const {
+    CacheLine line;
+    line.state = (CacheLineState)states[slot];
+    line.valid = (line.state != INVALID);
+    line.dirty = (line.state == MODIFIED);
+    line.tag = line.valid ? tags[slot] : 0;
+    line.lastUsed = lastUsed ? lastUsed[slot] : 0;
+    return line;
+}
+
+unsigned int Cache::getSetIndex(uint64_t address) const {
+    return (unsigned int)((address >> blockOffsetBits) & setMask);
+}
+
+// The stored tag is the whole block number. Its low s bits repeat the set index, which keeps
+// the compare free of a shift by s.
+uint64_t Cache::getTag(uint64_t address) const {
+    return address >> blockOffsetBits;
+}
+
+unsigned int Cache::getBlockOffset(uint64_t address) const {
+    return (unsigned int)(address & (uint64_t)(blockSize - 1));
+}
+
+int Cache::findLineInSet(unsigned int setIndex, uint64_t tag) const {
+    return tagMatch(&tags[(size_t)setIndex * associativity], associativity, tag);
+}
+
+int Cache::emptyWay(unsigned int setIndex) const {
+    size_t base = (size_t)setIndex * associativity;
+    for (int way = 0; way < associativity; way++) {
+        if (states[base + way] == INVALID) {
+            return way;
+        }
+    }
+    return -1;
+}
+
+// xorshift64; the state is never 0
+uint64_t Cache::nextRandom() {
+    useClock ^= useClock << 13;
+    useClock ^= useClock >> 7;
+    useClock ^= useClock << 17;
+    return useClock;
+}
+
+CacheLineState Cache::evictLine(unsigned int setIndex, int lineIndex, uint64_t& blockAddress) {
+    size_t slot = (size_t)setIndex * associativity + lineIndex;
+    CacheLineState state = (CacheLineState)states[slot];
+    blockAddress = tags[slot] << blockOffsetBits;
+    setState((int)slot, INVALID);
+    return state;
+}
+
+template <ReplacementPolicy P>
+void Cache::insertAs(int slot) {
+    if (P == REPLACEMENT_LRU || P == REPLACEMENT_PLRU) {
+        touchAs<P>(slot);
+    } else if (P == REPLACEMENT_SRRIP) {
+        rrpv[slot] = RRPV_LONG;
+    } else if (P == REPLACEMENT_BRRIP) {
+        rrpv[slot] = (nextRandom() % BRRIP_LONG_ONE_IN == 0) ? RRPV_LONG : RRPV_MAX;
+    }
+}
+
+template <ReplacementPolicy P>
+int Cache::victimAs(unsigned int setIndex) {
+    size_t base = (size_t)setIndex * associativity;
+    if (P == REPLACEMENT_LRU) {
+        int victim = 0;
+        for (int way = 0; way < associativity; way++) {
+            if (states[base + way] == INVALID) {
+                return way;
+            }
+            if (lastUsed[base + way] < lastUsed[base + victim]) {
+                victim = way;
+            }
+        }
+        return victim;
+    }
+    if (P == REPLACEMENT_PLRU) {
+        uint64_t bits = plruBits[setIndex];
+        unsigned int node = 1;
+        while (node < (unsigned int)associativity) {
+            node = 2 * node + (unsigned int)((bits >> node) & 1);
+        }
+        return (int)(node - associativity);
+    }
+    if (P == REPLACEMENT_SRRIP || P == REPLACEMENT_BRRIP) {
+        // First way predicted distant; if there is none, age the whole set until one is, in one step
+        unsigned char* setRrpv = rrpv + base;
+        int victim = 0;
+        for (int way = 1; way < associativity; way++) {
+            if (setRrpv[way] > setRrpv[victim]) {
+                victim = way;
+            }
+        }
+        unsigned char age = (unsigned char)(RRPV_MAX - setRrpv[victim]);
+        if (age != 0) {
+            for (int way = 0; way < associativity; way++) {
+                setRrpv[way] = (unsigned char)(setRrpv[way] + age);
+            }
+        }
+        return victim;
+    }
+    return (int)(nextRandom() % (uint64_t)associativity);
+}
+
+template <ReplacementPolicy P>
+int Cache::allocateAs(uint64_t address, uint64_t& victimAddress, CacheLineState& victimState) {
+    unsigned int setIndex = getSetIndex(address);
+    // LRU finds an empty way in the same pass as the oldest stamp
+    int way = (P == REPLACEMENT_LRU) ? victimAs<P>(setIndex) : emptyWay(setIndex);
+    if (way < 0) {
+        way = victimAs<P>(setIndex);
+    }
+    if (states[(size_t)setIndex * associativity + way] == INVALID) {
+        victimState = INVALID;
+    } else {
+        victimState = evictLine(setIndex, way, victimAddress);
+    }
+    int slot = (int)setIndex * associativity + way;
+    tags[slot] = getTag(address);
+    insertAs<P>(slot);
+    return slot;
+}
+
+int Cache::allocateLine(uint64_t address, uint64_t& victimAddress, CacheLineState& victimState) {
+#ifdef L1SIM_REPLACEMENT
+    return allocateAs<L1SIM_REPLACEMENT>(address, victimAddress, victimState);
+#else
+    switch (policy) {
+        case REPLACEMENT_PLRU: return allocateAs<REPLACEMENT_PLRU>(address, victimAddress, victimState);
+        case REPLACEMENT_SRRIP: return allocateAs<REPLACEMENT_SRRIP>(address, victimAddress, victimState);
+        case REPLACEMENT_BRRIP: return allocateAs<REPLACEMENT_BRRIP>(address, victimAddress, victimState);
+        case REPLACEMENT_RANDOM: return allocateAs<REPLACEMENT_RANDOM>(address, victimAddress, victimState);
+        default: return allocateAs<REPLACEMENT_LRU>(address, victimAddress, victimState);
+    }
+#endif
+}
+
+// touch() for the policies other than LRU, kept out of line
+void Cache::touchOther(int slot) {
+    switch (policy) {
+        case REPLACEMENT_PLRU: touchAs<REPLACEMENT_PLRU>(slot); break;
+        case REPLACEMENT_SRRIP:
+        case REPLACEMENT_BRRIP: touchAs<REPLACEMENT_SRRIP>(slot); break;
+        default: break;
+    }
+}
+
+void Cache::printState() const {
+    std::cout << "Core " << coreId << " cache (" << numSets << " sets x " << associativity
+              << " ways, " << tagBits << " tag bits):" << std::endl;
+    for (int set = 0; set < numSets; set++) {
+        size_t base = (size_t)set * associativity;
+        bool any = false;
+        for (int way = 0; way < associativity; way++) {
+            if (states[base + way] != INVALID) any = true;
+        }
+        if (!any) continue;
+        std::cout << "  Set " << set << ":";
+        for (int way = 0; way < associativity; way++) {
+            if (states[base + way] == INVALID) {
+                std::cout << " [-]";
+            } else {
+                std::cout << " [" << std::hex << tags[base + way] << std::dec << " "
+                          << stateToString((CacheLineState)states[base + way]) << "]";
+            }
+        }
+        std::cout << std::endl;
+    }
+}
@@ -3,8 +3,38 @@
 
 #include "utils.h"
 #include "CacheLine.h"
-#include <vector>
+#include "Replacement.h"
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 
+// Tag stored in invalid ways. Stored tags are block numbers (address >> b, at most 63 bits),
+// so no address maps to it and a plain tag compare also checks validity.
+const uint64_t INVALID_TAG = ~(uint64_t)0;
+
+enum TagMatchKind {
+    TAG_MATCH_SCALAR,
+    TAG_MATCH_SSE2,
+    TAG_MATCH_AVX2
+};
+
+// Tag compare over one set's ways: way of tag in setTags[0 .. ways), or -1
+typedef int (*TagMatchFn)(const uint64_t* setTags, int ways, uint64_t tag);
+
+// Same search through an explicitly chosen implementation
+int matchTag(TagMatchKind kind, const uint64_t* setTags, int ways, uint64_t tag);
+// Fastest implementation the CPU supports for the given associativity
+TagMatchKind bestTagMatch(int ways);
+const char* tagMatchName(TagMatchKind kind);
+
+//
+// Set-associative tag store of one core's private cache. Lines are kept as flat
+// struct-of-arrays: the line in way w of set s lives at slot s * associativity + w
+// of each array, so one set's tags, states and replacement metadata are contiguous. All
+// arrays, and the optional block payloads, are carved out of a single arena allocation.
+// Coherence and statistics are handled by CacheSimulator.
+//
 class Cache {
 private:
     int coreId;
@@ -14,92 +44,139 @@ private:
     int blockOffsetBits;
     int setIndexBits;
     int tagBits;
-    std::vector<CacheSet> sets;
-    
-    // Statistics
-    int readCount;
-    int writeCount;
-    int missCount;
-    int hitCount;
-    int evictionCount;
-    int writebackCount;
-    int totalCycles;
-    int idleCycles;
-    int busInvalidations;
-    int busTraffic; // in bytes
-    
+
+    int waysLog2;           // PLRU only: associativity is 1 << waysLog2
+    ReplacementPolicy policy;
+
+    std::unique_ptr<unsigned char[]> arena;
+    uint64_t* tags;         // INVALID_TAG in every way whose state is INVALID
+    uint64_t* lastUsed;     // LRU: use stamp per line, else nullptr
+    uint64_t* plruBits;     // PLRU: tree bits per set, node n (1 .. E - 1) in bit n, else nullptr
+    unsigned char* rrpv;    // SRRIP, BRRIP: RRPV per line, else nullptr
+    unsigned char* states;  // CacheLineState, INVALID marks an empty way
+    unsigned char* data;    // blockSize bytes per line, nullptr in the default metadata-only mode
+    uint64_t useClock;      // LRU stamp clock, or the xorshift state of RANDOM and BRRIP
+    size_t arenaSize;
+
+    TagMatchFn tagMatch; // scalar, SSE2 or AVX2, picked once per cache
+    uint64_t setMask;
+
+    // Whole lookup for one geometry: a compile-time specialization when (E, b) is in the
+    // instantiated table, otherwise the generic runtime path
+    typedef int (*FindLineFn)(const Cache* cache, uint64_t address);
+    FindLineFn findLineFn;
+    static FindLineFn specializedFindLine(int E, int b);
+    static int findLineGeneric(const Cache* cache, uint64_t address);
+    template <int E, int B>
+    static int findLineFixed(const Cache* cache, uint64_t address);
+
     // Helper functions
-    unsigned int getSetIndex(unsigned int address) const;
-    unsigned int getTag(unsigned int address) const;
-    unsigned int getBlockOffset(unsigned int address) const;
-    int findLineInSet(unsigned int setIndex, unsigned int tag) const;
-    int getLRULine(unsigned int setIndex);
-    void updateLRU(unsigned int setIndex, int lineIndex);
-    void evictLine(unsigned int setIndex, int lineIndex, int& cycle);
+    unsigned int getSetIndex(uint64_t address) const;
+    uint64_t getTag(uint64_t address) const;
+    unsigned int getBlockOffset(uint64_t address) const;
+    int findLineInSet(unsigned int setIndex, uint64_t tag) const;
+    int emptyWay(unsigned int setIndex) const;
+    uint64_t nextRandom();
+    CacheLineState evictLine(unsigned int setIndex, int lineIndex, uint64_t& blockAddress);
+
+    // One policy's bookkeeping (Cache.cpp): a hit, a fill of a just allocated slot, and the
+    // victim way of a set (of a full one; LRU also returns an empty way, found in the same pass)
+    template <ReplacementPolicy P>
+    void touchAs(int slot);
+    template <ReplacementPolicy P>
+    void insertAs(int slot);
+    template <ReplacementPolicy P>
+    int victimAs(unsigned int setIndex);
+    template <ReplacementPolicy P>
+    int allocateAs(uint64_t address, uint64_t& victimAddress, CacheLineState& victimState);
+    void touchOther(int slot);
 
 public:
-    Cache(int coreId, int s, int E, int b);
-    
-    // Core cache operations
-    bool processRequest(MemoryOperation op, unsigned int address, int& cycle, 
-                      std::vector<Cache*>& otherCaches);
-    
-    // Bus snooping operations
-    bool handleBusRequest(BusTransaction busOp, unsigned int address, 
-                        Cache* requestingCache, int& cycle, int& bytesTransferred);
-    bool checkDataInOtherCaches(unsigned int address, std::vector<Cache*>& otherCaches, 
-                               int& bytesTransferred);
-    
-    // Statistics functions
-    int getReadCount() const { return readCount; }
-    int getWriteCount() const { return writeCount; }
-    int getMissCount() const { return missCount; }
-    int getHitCount() const { return hitCount; }
-    int getEvictionCount() const { return evictionCount; }
-    int getWritebackCount() const { return writebackCount; }
-    int getTotalCycles() const { return totalCycles; }
-    int getIdleCycles() const { return idleCycles; }
-    int getBusInvalidations() const { return busInvalidations; }
-    int getBusTraffic() const { return busTraffic; }
-    double getMissRate() const { 
-        return (readCount + writeCount > 0) ? 
-            (double)missCount / (readCount + writeCount) : 0.0; 
+    Cache(int coreId, int s, int E, int b, bool withData = false,
+          ReplacementPolicy policy = DEFAULT_REPLACEMENT);
+
+    // Slot of the valid line holding address, or -1
+    int findLine(uint64_t address) const { return findLineFn(this, address); }
+    bool isSpecialized() const { return findLineFn != &Cache::findLineGeneric; }
+    CacheLineState getState(int slot) const { return (CacheLineState)states[slot]; }
+    // Block number (address >> b) of a valid or just allocated slot
+    uint64_t getBlock(int slot) const { return tags[slot]; }
+    void setState(int slot, CacheLineState state) {
+        states[slot] = (unsigned char)state;
+        if (state == INVALID) tags[slot] = INVALID_TAG;
     }
-    
-    // Debug function
-    void printState();
-
-    // Add this method declaration to the public section:
-    void printDebugInfo(MemoryOperation op, unsigned int address, bool isHit, CacheLineState oldState = INVALID, CacheLineState newState = INVALID);    
-
-    // Add to public methods
-    void addIdleTime(int cycles) { idleCycles += cycles; }
-
-    // New method to handle cache-to-cache transfer receipt
-    void receiveCacheToCache(unsigned int address, CacheLineState newState, int transferCycles) {
-        unsigned int setIndex = getSetIndex(address);
-        unsigned int tag = getTag(address);
-        int lineIndex = findLineInSet(setIndex, tag);
-        
-        // Add transfer cycles to idle time
-        idleCycles += transferCycles;
-        
-        // After transfer is complete, update the cache (1 additional cycle)
-        totalCycles += 1;
+    ReplacementPolicy replacementPolicy() const { return policy; }
+    // Records a hit on slot. Builds with a compile-time policy (make REPLACEMENT=...) call it
+    // directly; otherwise the LRU stamp is inline and the rest dispatch on the policy.
+    void touch(int slot) {
+#ifdef L1SIM_REPLACEMENT
+        touchAs<L1SIM_REPLACEMENT>(slot);
+#else
+        if (policy == REPLACEMENT_LRU) {
+            lastUsed[slot] = ++useClock;
+        } else {
+            touchOther(slot);
+        }
+#endif
     }
 
-    // Add to public section:
+    // Picks a way for address (an empty one, else the policy's victim), evicting its current block,
+    // and records the fill with the policy. Returns the slot, left INVALID for the caller to fill;
+    // victimState is INVALID if nothing was evicted.
+    int allocateLine(uint64_t address, uint64_t& victimAddress, CacheLineState& victimState);
+
     CacheLineState getLineState(unsigned int setIndex, int lineIndex) const {
-        if (lineIndex != -1 && setIndex < sets.size()) {
-            return sets[setIndex].lines[lineIndex].state;
+        if (lineIndex != -1 && setIndex < (unsigned int)numSets) {
+            return getState(setIndex * associativity + lineIndex);
         }
         return INVALID;
     }
 
+    // Block payload of a line, or nullptr for a metadata-only cache
+    unsigned char* lineData(int slot) { return data ? data + (size_t)slot * blockSize : nullptr; }
+    CacheLine getLine(int slot) const;
+    size_t arenaBytes() const { return arenaSize; }
+
+    // Whole contents (tags, replacement metadata, states, payload) as arenaBytes() bytes, and the
+    // policy's clock or generator state, for checkpoints
+    const unsigned char* image() const { return arena.get(); }
+    uint64_t lruClock() const { return useClock; }
+    // Replaces the contents with an image taken from a cache of the same geometry and policy
+    void restoreImage(const unsigned char* bytes, uint64_t clock) {
+        std::copy(bytes, bytes + arenaSize, arena.get());
+        useClock = clock;
+    }
+
+    // Debug function
+    void printState() const;
+
     // Public accessors for debugging
-    unsigned int getSetIndexPublic(unsigned int address) const { return getSetIndex(address); }
-    unsigned int getTagPublic(unsigned int address) const { return getTag(address); }
-    int findLineInSetPublic(unsigned int setIndex, unsigned int tag) const { return findLineInSet(setIndex, tag); }
+    unsigned int getSetIndexPublic(uint64_t address) const { return getSetIndex(address); }
+    uint64_t getTagPublic(uint64_t address) const { return getTag(address); }
+    int findLineInSetPublic(unsigned int setIndex, uint64_t tag) const { return findLineInSet(setIndex, tag); }
 };
 
+template <ReplacementPolicy P>
+inline void Cache::touchAs(int slot) {
+    if (P == REPLACEMENT_LRU) {
+        lastUsed[slot] = ++useClock;
+    } else if (P == REPLACEMENT_PLRU) {
+        // Walk from the root to the way's leaf, pointing every node at the other half
+        uint64_t& bits = plruBits[slot >> waysLog2];
+        unsigned int way = (unsigned int)slot & (unsigned int)(associativity - 1);
+        unsigned int node = 1;
+        for (int level = waysLog2 - 1; level >= 0; level--) {
+            unsigned int right = (way >> level) & 1;
+            if (right) {
+                bits &= ~((uint64_t)1 << node);
+            } else {
+                bits |= (uint64_t)1 << node;
+            }
+            node = 2 * node + right;
+        }
+    } else if (P == REPLACEMENT_SRRIP || P == REPLACEMENT_BRRIP) {
+        rrpv[slot] = 0;
+    }
+}
+
 #endif // CACHE_H
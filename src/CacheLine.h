@@ -2,32 +2,18 @@
 #define CACHE_LINE_H
 
 #include "utils.h"
-#include <vector>
 
-// Structure to represent a cache line
+// Metadata of one cache line. Cache stores these fields in flat per-cache arrays and hands
+// out CacheLine copies for inspection; block contents are not simulated unless the cache
+// was built with a data arena (see Cache::lineData).
 struct CacheLine {
     bool valid;
     bool dirty;
     CacheLineState state;
-    unsigned int tag;
-    unsigned int lastUsed; // For LRU replacement
-    std::vector<unsigned char> data;
+    uint64_t tag;
+    uint64_t lastUsed; // For LRU replacement
 
-    CacheLine(int blockSize) : valid(false), dirty(false), 
-                              state(INVALID), tag(0), lastUsed(0) {
-        data.resize(blockSize, 0);
-    }
-};
-
-// Structure to represent a cache set
-struct CacheSet {
-    std::vector<CacheLine> lines;
-    
-    CacheSet(int associativity, int blockSize) {
-        for (int i = 0; i < associativity; i++) {
-            lines.push_back(CacheLine(blockSize));
-        }
-    }
+    CacheLine() : valid(false), dirty(false), state(INVALID), tag(0), lastUsed(0) {}
 };
 
 #endif // CACHE_LINE_H
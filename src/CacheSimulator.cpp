@@ -1,4 +1,12 @@
 #include "CacheSimulator.h"
+#include "Cache.h"
+#include "SharedCache.h"
+#include "SplitBus.h"
+#include "TraceReader.h"
+#include "Checkpoint.h"
+#include "IntervalStats.h"
+#include "EventLog.h"
+#include "Log.h"
 #include "utils.h"
 #include <utility>
 #include <memory>        
@@ -7,78 +15,152 @@
 #include <sstream>
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include <cmath>
 #include <algorithm>
 #include <iomanip>
-#include <cassert>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <climits>
+#include <cstring>
 using namespace std;
 
+// Counts of the functional fast-forward phase, reported apart from the detailed statistics
+struct FastForwardStats {
+    long long instructions;
+    long long reads;
+    long long writes;
+    long long misses;
+    long long evictions;
+    long long writebacks;
+    long long invalidations;
+};
+
 struct CoreState {
-    std::unique_ptr<std::ifstream> trace;
-    std::string currentLine;
+    CoreState(int coreId, int s, int E, int b) : cache(coreId, s, E, b) {}
+
+    std::unique_ptr<TraceSource> trace;
+    const TraceRecord* chunk; // current batch of decoded records
+    uint64_t chunkBase;       // records of the trace before the current chunk
+    size_t chunkLen;
+    size_t chunkPos;          // chunk[chunkPos] is the current instruction
     bool finished;
-    int extime;    // execution time counter
-    int idletime;  // idle time counter
+    long long readyCycle; // next cycle in which the core acts
+    bool pendingComplete; // waiting on its own bus transaction, the instruction retires at readyCycle
+    bool waitingForBus;   // last step stalled on a busy bus
+    long long busRequestCycle; // split bus: first cycle the current instruction needed the bus, or -1
+    long long extime;    // execution time counter
+    long long retiredInQuantum; // parallel engine: retired since the last barrier, not yet in retiredInstructions
+    long long idletime;  // idle time counter
     
-    // Simplified cache: maps an address to a MESI state
-    std::unordered_map<unsigned int, CacheLineState> cache;
+    Cache cache;   // private L1 tag store with per-line MESI states
     
     // Statistics
-    int totalInstructions;
-    int readCount;
-    int writeCount;
-    int missCount;
-    int hitCount;
-    int evictionCount;
-    int writebackCount;
-    int busInvalidations;
-    int dataTraffic; // in bytes
+    long long totalInstructions;
+    long long readCount;
+    long long writeCount;
+    long long missCount;
+    long long hitCount;
+    long long evictionCount;
+    long long writebackCount;
+    long long busInvalidations;
+    long long dataTraffic; // in bytes
+
+    long long sampledAtStart[NUM_SAMPLED_STATS]; // sampled counters when the current instruction started
+    FastForwardStats fastForward;
+    ProfileCounters profile;
 };
 
+// Current values of the counters that sampling attributes to units
+static void readSampledCounters(const CoreState &core, long long values[NUM_SAMPLED_STATS]) {
+    values[SAMPLED_IDLE_CYCLES] = core.idletime;
+    values[SAMPLED_MISSES] = core.missCount;
+    values[SAMPLED_EVICTIONS] = core.evictionCount;
+    values[SAMPLED_WRITEBACKS] = core.writebackCount;
+    values[SAMPLED_INVALIDATIONS] = core.busInvalidations;
+    values[SAMPLED_TRAFFIC] = core.dataTraffic;
+    values[SAMPLED_REFERENCES] = 0; // counted at attribution
+}
+
 CacheSimulator::CacheSimulator(const std::string& traceFilePrefix, int s, int E, int b, 
-                              const std::string& outFileName, bool debug)
-    : outFileName(outFileName), debugMode(debug) {
+                              const std::string& outFileName, bool debug, int numCores, int level)
+    // Open trace sources (text or binary, detected from the prefix): one per core
+    : CacheSimulator(openTraceSources(traceFilePrefix, numCores), s, E, b, outFileName, debug, level) {
+}
+
+CacheSimulator::CacheSimulator(std::vector<std::unique_ptr<TraceSource> > sources, int s, int E, int b,
+                               const std::string& outFileName, bool debug, int level)
+    : outFileName(outFileName), debugMode(debug),
+      logLevel(level >= 0 ? level : (debug ? LOG_LEVEL_TRACE : LOG_LEVEL_OFF)),
+      directory((int)sources.size(), sources.size() * ((size_t)E << s)) {
+    // The level is known before the first message, so the setup below already follows it
+    if (level < -1 || level > LOG_LEVEL_TRACE) {
+        throw std::invalid_argument("log level must be between 0 and 3");
+    }
+    if (sources.empty()) {
+        throw std::invalid_argument("the simulator needs at least one trace source");
+    }
     
     // Store configuration parameters
     setIndexBits = s;
     associativity = E;
     blockBits = b;
     numSets = 1 << s;
-    numCores = 4; // Quad-core simulation
+    replacementPolicy = DEFAULT_REPLACEMENT;
+    numCores = (int)sources.size(); // one core per trace
     totalInvalidations = 0;
     totalBusTraffic = 0;
     totalBusTransactions = 0;
     busTransaction = BusTransaction::None;
     globalCycle = 0;
-    busFree = true;
+    busNextFree = 0;
     busOwner = -1;
+    parallelThreads = 0;
+    quantumCycles = 0;
+    windowUnit = -1;
+    retiredInstructions = 0;
+    stopAtRetired = LLONG_MAX;
+    stopAtCycle = LLONG_MAX;
+    checkpointAtRetired = LLONG_MAX;
+    checkpointAtCycle = LLONG_MAX;
+    restored = false;
+    fastForwardRefs = 0;
+    intervalCycles = 0;
+    nextIntervalCycle = LLONG_MAX;
+    busBusyCycles = 0;
+    dataCheck = false;
+    lastVersion = 0;
+    checkedReads = 0;
+    profileClock.ticks = 0;
+    profileClock.nanoseconds = 0.0;
     
     // Block size (in bytes) from b bits: blockSize = 2^b
     blockSize = 1 << b;
     
-    debugPrint("Initializing simulator with " + std::to_string(numCores) + " cores");
-    debugPrint("Block size: " + std::to_string(blockSize) + " bytes");
+    LOG_INFO("Initializing simulator with " + std::to_string(numCores) + " cores");
+    LOG_INFO("Block size: " + std::to_string(blockSize) + " bytes");
     
-    // Open trace files: one per core
     for (int i = 0; i < numCores; i++) {
-        CoreState core;
-        std::string fileName = traceFilePrefix + "_proc" + std::to_string(i) + ".trace";
-        // C++11 has no make_unique; reset the unique_ptr instead
-        core.trace.reset(new std::ifstream(fileName));
-        if (!core.trace->is_open()) {
-            std::cerr << "Error opening trace file: " << fileName << std::endl;
-            exit(1);
-        }
-        // Read the first line if possible
-        if (std::getline(*core.trace, core.currentLine)) {
-            debugPrint("Core " + std::to_string(i) + " first instruction: " + core.currentLine);
+        CoreState core(i, s, E, b);
+        core.trace = std::move(sources[i]);
+        core.chunk = nullptr;
+        core.chunkBase = 0;
+        core.chunkPos = 0;
+        core.chunkLen = core.trace->nextChunk(core.chunk);
+        core.finished = (core.chunkLen == 0);
+        if (core.finished) {
+            LOG_INFO("Core " + std::to_string(i) + " trace file empty");
         } else {
-            core.finished = true;
-            debugPrint("Core " + std::to_string(i) + " trace file empty");
+            LOG_INFO("Core " + std::to_string(i) + " first instruction: " + recordToString(core.chunk[0]));
         }
-        core.finished = false;
+        core.readyCycle = 1;
+        core.pendingComplete = false;
+        core.waitingForBus = false;
+        core.busRequestCycle = -1;
         core.extime = 0;
+        core.retiredInQuantum = 0;
         core.idletime = 0;
         
         // Initialize statistics
@@ -91,709 +173,1810 @@ CacheSimulator::CacheSimulator(const std::string& traceFilePrefix, int s, int E,
         core.writebackCount = 0;
         core.busInvalidations = 0;
         core.dataTraffic = 0;
+        std::fill(core.sampledAtStart, core.sampledAtStart + NUM_SAMPLED_STATS, 0);
+        core.fastForward = FastForwardStats();
         
         cores.emplace_back(std::move(core));  // Use emplace_back to avoid unnecessary copies
     }
+    LOG_INFO(std::string("Cache lookup: ") + (cores[0].cache.isSpecialized() ?
+             "compile-time specialization" : "generic runtime path") +
+             " for E=" + std::to_string(E) + ", b=" + std::to_string(b));
 }
 
 CacheSimulator::~CacheSimulator() {
-    // Close trace files
-    for (auto &core : cores) {
-        if (core.trace && core.trace->is_open())
-            core.trace->close();
-    }
+    // Trace sources close their files when the cores are destroyed
 }
 
 void CacheSimulator::debugPrint(const std::string& message) {
-    if (debugMode) {
-        std::cout << "[Cycle " << globalCycle << "] " << message << std::endl;
+    std::cout << "[Cycle " << globalCycle << "] " << message << std::endl;
+}
+
+// Bus latencies in cycles
+static const int MEM_ACCESS_CYCLES = 100; // memory fetch or write back of one block
+
+// Every MESI state change of a resident line goes through here, keeping the directory in step.
+// The silent E -> M upgrade of a write hit leaves the directory alone (it does not tell E from
+// M), so hits never touch shared state. A MODIFIED line leaving M is written back.
+void CacheSimulator::setLineState(int coreId, int slot, CacheLineState state) {
+    Cache &cache = cores[coreId].cache;
+    if (dataCheck && cache.getState(slot) == MODIFIED && state != MODIFIED) {
+        versionBelow[cache.getBlock(slot)] = lineVersion(coreId, slot); // the write back
+    }
+    if (!(state == MODIFIED && cache.getState(slot) == EXCLUSIVE)) {
+        directory.setState(cache.getBlock(slot), coreId, state);
     }
+    cache.setState(slot, state);
 }
 
-void CacheSimulator::runSimulation() {
-    // Continue until every core has finished processing its trace
+// Brings the block of address into the core's cache in the given state, with the data of another
+// copy or of the level below. Returns the bus cycles spent writing back the victim from the given
+// cycle on (0 when the victim was clean, or the way empty; an exclusive L2 also takes clean victims).
+int CacheSimulator::fillLine(int coreId, uint64_t address, CacheLineState state, long long cycle) {
+    CoreState &core = cores[coreId];
+    uint64_t victimAddress;
+    CacheLineState victimState;
+    int slot = core.cache.allocateLine(address, victimAddress, victimState);
+    int writebackCycles = 0;
+    if (victimState != INVALID) {
+        directory.setState(victimAddress >> blockBits, coreId, INVALID);
+        core.evictionCount++;
+        if (eventLog) {
+            logEvent(globalCycle, coreId, EVENT_EVICT, victimAddress, core.chunk[core.chunkPos].op, victimState,
+                     INVALID, BusTransaction::None);
+        }
+        LOG_INFO("Core " + std::to_string(coreId) + " evicts block " + toHex(victimAddress) +
+                 " (state: " + stateToString(victimState) + ")");
+        writebackCycles = writeBelow(coreId, cycle, victimAddress, victimState == MODIFIED);
+        if (victimState == MODIFIED) {
+            if (dataCheck) versionBelow[victimAddress >> blockBits] = lineVersion(coreId, slot);
+            core.writebackCount++;
+            core.dataTraffic += blockSize;
+            totalBusTraffic += blockSize;
+            totalBusTransactions++;
+        }
+    }
+    if (dataCheck) {
+        // From another cache holding the block, else from below
+        uint64_t block = address >> blockBits;
+        int entry = directory.find(block);
+        if (entry >= 0) {
+            int supplier = directory.firstSharer(entry);
+            setLineVersion(coreId, slot, lineVersion(supplier, cores[supplier].cache.findLine(address)));
+        } else {
+            std::unordered_map<uint64_t, uint64_t>::const_iterator below = versionBelow.find(block);
+            setLineVersion(coreId, slot, below == versionBelow.end() ? 0 : below->second);
+        }
+    }
+    setLineState(coreId, slot, state);
+    return writebackCycles;
+}
+
+//
+// Below the L1s: memory, or the shared L2 (setSharedCache). Accesses are issued in a given cycle
+// and return the cycles until they complete. Without an L2 every fetch and every write back of a
+// dirty block takes MEM_ACCESS_CYCLES. With one, a lookup waits for its bank and takes the L2
+// latency, plus MEM_ACCESS_CYCLES on a miss. L2 write backs to memory, and those of MODIFIED L1
+// copies hit by back-invalidation, go out through a write buffer and cost the cores no time.
+//
+
+// Fetch of the block of address for an L1 fill. dirty is set when an exclusive L2 hands up a
+// block that memory does not have, which the L1 then has to hold as MODIFIED.
+int CacheSimulator::readBelow(int coreId, long long cycle, uint64_t address, bool &dirty) {
+    dirty = false;
+    if (!l2) {
+        return MEM_ACCESS_CYCLES;
+    }
+    long long done = l2->bankAccess(cycle, address >> blockBits);
+    int slot = l2->cache.findLine(address);
+    if (slot >= 0) {
+        l2->stats.hits++;
+        if (l2->config.inclusion == INCLUSION_EXCLUSIVE) {
+            dirty = (l2->cache.getState(slot) == MODIFIED);
+            l2->cache.setState(slot, INVALID); // moves up to the L1
+        } else {
+            l2->cache.touch(slot);
+        }
+        LOG_INFO("Core " + std::to_string(coreId) + " L2 hit for block " + toHex(address));
+        return (int)(done - cycle);
+    }
+    l2->stats.misses++;
+    if (l2->config.inclusion != INCLUSION_EXCLUSIVE) {
+        allocateBelow(coreId, address, EXCLUSIVE);
+    }
+    LOG_INFO("Core " + std::to_string(coreId) + " L2 miss for block " + toHex(address));
+    return (int)(done - cycle) + MEM_ACCESS_CYCLES;
+}
+
+// A block leaving an L1 copy (an evicted victim, or the write back of a MODIFIED owner). Only
+// dirty data moves down, except into an exclusive L2, which takes the last L1 copy of a block
+// clean or dirty and cannot hold blocks other L1s still have.
+int CacheSimulator::writeBelow(int coreId, long long cycle, uint64_t address, bool dirty) {
+    if (!l2) {
+        return dirty ? MEM_ACCESS_CYCLES : 0;
+    }
+    uint64_t block = address >> blockBits;
+    if (l2->config.inclusion == INCLUSION_EXCLUSIVE) {
+        if (directory.find(block) >= 0) {
+            return dirty ? MEM_ACCESS_CYCLES : 0;
+        }
+    } else if (!dirty) {
+        return 0;
+    }
+    l2->stats.writes++;
+    long long done = l2->bankAccess(cycle, block);
+    int slot = l2->cache.findLine(address);
+    if (slot < 0) {
+        allocateBelow(coreId, address, dirty ? MODIFIED : EXCLUSIVE);
+    } else if (dirty) {
+        l2->cache.setState(slot, MODIFIED);
+    }
+    return (int)(done - cycle);
+}
+
+// Places the block of address in the L2, evicting its victim: to memory if dirty, and out of
+// every L1 too when the L2 is inclusive
+void CacheSimulator::allocateBelow(int coreId, uint64_t address, CacheLineState state) {
+    uint64_t victimAddress;
+    CacheLineState victimState;
+    int slot = l2->cache.allocateLine(address, victimAddress, victimState);
+    l2->cache.setState(slot, state);
+    if (victimState == INVALID) {
+        return;
+    }
+    l2->stats.evictions++;
+    bool dirty = (victimState == MODIFIED);
+    int entry = directory.find(victimAddress >> blockBits);
+    if (l2->config.inclusion == INCLUSION_INCLUSIVE && entry >= 0) {
+        directory.copySharers(entry, sharerScratch);
+        for (size_t w = 0; w < sharerScratch.size(); w++) {
+            for (uint64_t bits = sharerScratch[w]; bits != 0; bits &= bits - 1) {
+                int j = (int)(w * 64) + __builtin_ctzll(bits);
+                int otherSlot = cores[j].cache.findLine(victimAddress);
+                CacheLineState otherState = cores[j].cache.getState(otherSlot);
+                if (otherState == MODIFIED) {
+                    dirty = true;
+                    cores[j].writebackCount++;
+                    cores[j].dataTraffic += blockSize;
+                    totalBusTraffic += blockSize;
+                }
+                setLineState(j, otherSlot, INVALID);
+                l2->stats.backInvalidations++;
+                if (eventLog) {
+                    logEvent(globalCycle, j, EVENT_EVICT, victimAddress, cores[coreId].chunk[cores[coreId].chunkPos].op,
+                             otherState, INVALID, BusTransaction::None);
+                }
+                LOG_INFO("L2 eviction invalidates Core " + std::to_string(j) + " copy of block " +
+                         toHex(victimAddress) + " (was " + stateToString(otherState) + ")");
+            }
+        }
+    }
+    if (dirty) {
+        l2->stats.memoryWritebacks++;
+    }
+}
+
+// Moves the core to its next trace record, pulling a new chunk when needed
+void CacheSimulator::advanceTrace(int coreId) {
+    CoreState &core = cores[coreId];
+    if (++core.chunkPos == core.chunkLen) {
+        core.chunkBase += core.chunkLen;
+        core.chunkPos = 0;
+        PROFILE_SCOPE_ALWAYS(core.profile, PROFILE_TRACE_DECODE);
+        core.chunkLen = core.trace->nextChunk(core.chunk);
+    }
+    if (core.chunkLen == 0) {
+        core.finished = true;
+        LOG_INFO("Core " + std::to_string(coreId) + " has no more instructions");
+    } else {
+        LOG_DEBUG("Core " + std::to_string(coreId) + " next instruction: " +
+                  recordToString(core.chunk[core.chunkPos]));
+    }
+}
+
+// The current instruction executes in this cycle and the core moves on
+void CacheSimulator::retireInstruction(int coreId, long long cycle) {
+    CoreState &core = cores[coreId];
+    {
+        PROFILE_SCOPE(core.profile, PROFILE_STATISTICS);
+        core.extime++;
+        core.readyCycle = cycle + 1;
+        // The parallel workers retire concurrently; their counts are merged at the barrier
+        if (parallelThreads > 0) {
+            core.retiredInQuantum++;
+        } else {
+            retiredInstructions++;
+        }
+        if (estimator) {
+            attributeRetirement(coreId);
+        }
+    }
+    advanceTrace(coreId);
+}
+
+// Grants coreId's transaction on the split-transaction bus; returns the cycles until its block
+// has arrived
+int CacheSimulator::grantSplitBus(int coreId, long long cycle, int latencyCycles, int writebacks) {
+    CoreState &core = cores[coreId];
+    long long dataBusy = splitBus->stats.dataBusyCycles;
+    long long arrived = splitBus->grant(cycle, cycle - core.busRequestCycle, latencyCycles, writebacks);
+    busNextFree = splitBus->nextGrant();
+    busBusyCycles += splitBus->stats.dataBusyCycles - dataBusy;
+    core.busRequestCycle = -1;
+    return (int)(arrived - cycle);
+}
+
+// Places a transaction on the bus for coreId. On the atomic bus the core stalls for coreCycles
+// and then retires its instruction, and the bus stays occupied for busCycles (>= coreCycles). On
+// the split-transaction bus the block is ready latencyCycles after the address phase and
+// writebacks more blocks follow it on the data bus; the core retires once its block has arrived.
+void CacheSimulator::startBusTransaction(int coreId, long long cycle, BusTransaction type,
+                                         int coreCycles, int busCycles, int latencyCycles, int writebacks) {
+    CoreState &core = cores[coreId];
+    busOwner = coreId;
+    busTransaction = type;
+    if (splitBus) {
+        coreCycles = grantSplitBus(coreId, cycle, latencyCycles, writebacks);
+    } else {
+        busNextFree = cycle + busCycles;
+        busBusyCycles += busCycles;
+    }
+    totalBusTransactions++;
+
+    core.idletime += coreCycles;
+    core.readyCycle = cycle + coreCycles;
+    core.pendingComplete = true;
+}
+
+//
+// Executes the core's current instruction if it hits without needing the bus (1 cycle, only the
+// core's own cache changes). Returns false, with slot set to the line found or -1, otherwise.
+//
+bool CacheSimulator::executeHit(int coreId, long long cycle, int &slot) {
+    CoreState &core = cores[coreId];
+    if (sampling.setSampling() && skipUnsampled(coreId)) {
+        return true; // the trace ended on unsampled references
+    }
+    const TraceRecord &record = core.chunk[core.chunkPos];
+    uint64_t address = record.address;
+    {
+        PROFILE_SCOPE(core.profile, PROFILE_LOCAL_LOOKUP);
+        slot = core.cache.findLine(address);
+        CacheLineState ownState = (slot < 0) ? INVALID : core.cache.getState(slot);
+        LOG_DEBUG("Core " + std::to_string(coreId) + " processing: " + recordToString(record));
+
+        if (ownState == INVALID || (record.op == WRITE && ownState == SHARED)) {
+            return false;
+        }
+        core.totalInstructions++;
+        core.hitCount++;
+        core.cache.touch(slot);
+        if (eventLog) {
+            logEvent(cycle, coreId, EVENT_HIT, address, record.op, ownState,
+                     record.op == WRITE ? MODIFIED : ownState, BusTransaction::None);
+        }
+        if (record.op == READ) {
+            core.readCount++;
+            if (dataCheck) checkRead(coreId, address);
+            PROFILE_EVENT(core.profile, PROFILE_READ_HIT);
+            LOG_DEBUG("Core " + std::to_string(coreId) + " READ HIT for address " +
+                      toHex(address) + " (state: " + stateToString(ownState) + ")");
+        } else {
+            core.writeCount++;
+            PROFILE_EVENT(core.profile, PROFILE_WRITE_HIT);
+            if (ownState != MODIFIED) {
+                setLineState(coreId, slot, MODIFIED);
+            }
+            if (dataCheck) recordWrite(coreId, address);
+            LOG_DEBUG("Core " + std::to_string(coreId) + " WRITE HIT for address " + toHex(address) +
+                      " (state: " + stateToString(ownState) + " -> M)");
+        }
+    }
+    retireInstruction(coreId, cycle);
+    return true;
+}
+
+//
+// Performs one action of a core in the given cycle: retire a completed bus request, execute a
+// hit, stall on a busy bus or start a bus transaction. Always leaves core.readyCycle > cycle,
+// with the stall cycles up to it already credited to idletime, so a driver only has to visit
+// the core again at readyCycle.
+//
+void CacheSimulator::stepCore(int coreId, long long cycle) {
+    CoreState &core = cores[coreId];
+    core.waitingForBus = false;
+
+    if (core.pendingComplete) {
+        // Bus transaction done: the instruction retires in this cycle
+        core.pendingComplete = false;
+        LOG_DEBUG("Core " + std::to_string(coreId) + " request complete");
+        retireInstruction(coreId, cycle);
+        return;
+    }
+
+    int slot;
+    if (executeHit(coreId, cycle, slot)) {
+        return;
+    }
+    uint64_t address = core.chunk[core.chunkPos].address;
+
+    // Everything else needs the bus; the core idles until it is released
+    if (splitBus && core.busRequestCycle < 0) {
+        core.busRequestCycle = cycle;
+    }
+    if (cycle < busNextFree) {
+        PROFILE_SCOPE(core.profile, PROFILE_BUS_ARBITRATION);
+        LOG_DEBUG("Core " + std::to_string(coreId) + " is stalled waiting for bus (owner: Core " +
+                  std::to_string(busOwner) + ")");
+        PROFILE_STALL(core.profile, STALL_BUS_BUSY, busNextFree - cycle);
+        core.idletime += busNextFree - cycle;
+        core.readyCycle = busNextFree;
+        core.waitingForBus = true;
+        return;
+    }
+
+    if (!estimator) {
+        issueBusRequest(coreId, cycle, slot);
+        return;
+    }
+    // Sampling: the bus activity of the request belongs to the unit of its address
+    int unit = sampleUnitOf(address);
+    long long transactions = totalBusTransactions;
+    long long traffic = totalBusTraffic;
+    issueBusRequest(coreId, cycle, slot);
+    if (unit >= 0) {
+        estimator->add(unit, numCores, SAMPLED_BUS_TRANSACTIONS, totalBusTransactions - transactions);
+        estimator->add(unit, numCores, SAMPLED_BUS_TRAFFIC, totalBusTraffic - traffic);
+    }
+}
+
+// Bus side of the core's current instruction; the bus is free in this cycle
+void CacheSimulator::issueBusRequest(int coreId, long long cycle, int slot) {
+    CoreState &core = cores[coreId];
+    const TraceRecord &record = core.chunk[core.chunkPos];
+    uint64_t address = record.address;
+    CacheLineState ownState = (slot < 0) ? INVALID : core.cache.getState(slot);
+    // Cycle the request reaches the memory side: after the address phase on the split bus
+    long long below = cycle + (splitBus ? splitBus->config.addressCycles : 0);
+
+    core.totalInstructions++;
+    if (record.op == READ) {
+        core.readCount++;
+        core.missCount++;
+        LOG_INFO("Core " + std::to_string(coreId) + " READ MISS for address " + toHex(address));
+
+        // Every other valid copy ends up SHARED, a MODIFIED one is also written back. Only an
+        // E or M owner changes state; the directory names it and the lowest-numbered supplier.
+        int supplier = -1;
+        int dirtyOwner = -1;
+        {
+            PROFILE_SCOPE(core.profile, PROFILE_REMOTE_SNOOP);
+            int entry = directory.find(address >> blockBits);
+            ProfileEvent path = PROFILE_READ_MISS_I;
+            if (entry >= 0) {
+                supplier = directory.firstSharer(entry);
+                path = PROFILE_READ_MISS_S;
+                int owner = directory.owner(entry);
+                if (owner >= 0) {
+                    int otherSlot = cores[owner].cache.findLine(address);
+                    CacheLineState otherState = cores[owner].cache.getState(otherSlot);
+                    if (otherState == MODIFIED) dirtyOwner = owner;
+                    path = (otherState == MODIFIED) ? PROFILE_READ_MISS_M : PROFILE_READ_MISS_E;
+                    setLineState(owner, otherSlot, SHARED);
+                    if (eventLog) {
+                        logEvent(cycle, owner, EVENT_SNOOP, address, READ, otherState, SHARED, BusTransaction::None);
+                    }
+                    LOG_INFO("Core " + std::to_string(owner) + " state changed from " +
+                             stateToString(otherState) + " to SHARED");
+                }
+            }
+            PROFILE_EVENT(core.profile, path);
+            (void)path;
+        }
+
+        if (supplier != -1) {
+            // Cache-to-cache transfer: 2 cycles per 4-byte word
+            int transferCycles = 2 * (blockSize / 4);
+            int busCycles = transferCycles;
+            int writebackCycles = fillLine(coreId, address, SHARED, below);
+            if (dataCheck) checkRead(coreId, address);
+            PROFILE_STALL(core.profile, STALL_CACHE_TO_CACHE, transferCycles);
+            PROFILE_STALL(core.profile, STALL_WRITEBACK, writebackCycles);
+            core.dataTraffic += blockSize;
+            totalBusTraffic += blockSize;
+            if (dirtyOwner != -1) {
+                // The owner's copy goes back to memory right after the transfer
+                busCycles += writeBelow(coreId, below + writebackCycles + transferCycles, address, true);
+                cores[dirtyOwner].writebackCount++;
+                cores[dirtyOwner].dataTraffic += blockSize;
+                totalBusTraffic += blockSize;
+                if (estimator) noteRemoteWriteback(dirtyOwner, address);
+            }
+            LOG_INFO("Core " + std::to_string(coreId) + " reads from Core " + std::to_string(supplier) +
+                     " cache-to-cache (" + std::to_string(transferCycles) + " cycles)");
+            startBusTransaction(coreId, cycle, ReadCacheToCache, writebackCycles + transferCycles,
+                                writebackCycles + busCycles, 0, (writebackCycles > 0) + (dirtyOwner != -1));
+            if (eventLog) {
+                logEvent(cycle, coreId, EVENT_MISS, address, READ, ownState, SHARED, ReadCacheToCache);
+            }
+            if (dirtyOwner != -1) {
+                totalBusTransactions++; // the write back
+            }
+        } else {
+            bool dirtyBelow;
+            int fetchCycles = readBelow(coreId, below, address, dirtyBelow);
+            CacheLineState fillState = dirtyBelow ? MODIFIED : EXCLUSIVE;
+            int writebackCycles = fillLine(coreId, address, fillState, below + fetchCycles);
+            if (dataCheck) checkRead(coreId, address);
+            PROFILE_STALL(core.profile, STALL_MEMORY, fetchCycles);
+            PROFILE_STALL(core.profile, STALL_WRITEBACK, writebackCycles);
+            core.dataTraffic += blockSize;
+            totalBusTraffic += blockSize;
+            LOG_INFO("Core " + std::to_string(coreId) + " fetches from memory");
+            startBusTransaction(coreId, cycle, ReadFromMem, writebackCycles + fetchCycles,
+                                writebackCycles + fetchCycles, fetchCycles, writebackCycles > 0);
+            if (eventLog) {
+                logEvent(cycle, coreId, EVENT_MISS, address, READ, ownState, fillState, ReadFromMem);
+            }
+        }
+        return;
+    }
+
+    // Writes: invalidate every other copy, a MODIFIED one is written back first
+    core.writeCount++;
+    bool upgrade = (ownState == SHARED);
+    int invalidated = 0;
+    int dirtyOwner = -1;
+    CacheLineState otherCopies = INVALID; // the strongest state among the copies invalidated
+    {
+        PROFILE_SCOPE(core.profile, PROFILE_REMOTE_SNOOP);
+        int entry = directory.find(address >> blockBits);
+        if (entry >= 0) {
+            // Walk a copy of the sharer bits: invalidating the last copy removes the entry
+            directory.copySharers(entry, sharerScratch);
+            for (size_t w = 0; w < sharerScratch.size(); w++) {
+                for (uint64_t bits = sharerScratch[w]; bits != 0; bits &= bits - 1) {
+                    int j = (int)(w * 64) + __builtin_ctzll(bits);
+                    if (j == coreId) continue;
+                    int otherSlot = cores[j].cache.findLine(address);
+                    CacheLineState otherState = cores[j].cache.getState(otherSlot);
+                    if (otherState == MODIFIED) dirtyOwner = j;
+                    if (otherState != SHARED) otherCopies = otherState;
+                    else if (otherCopies == INVALID) otherCopies = SHARED;
+                    setLineState(j, otherSlot, INVALID);
+                    invalidated++;
+                    if (eventLog) {
+                        logEvent(cycle, j, EVENT_SNOOP, address, WRITE, otherState, INVALID, BusTransaction::None);
+                    }
+                    LOG_INFO("Invalidated Core " + std::to_string(j) + " copy (was " + stateToString(otherState) + ")");
+                }
+            }
+        }
+    }
+    if (invalidated > 0) {
+        totalInvalidations += invalidated;
+        core.busInvalidations++;
+    }
+
+    if (upgrade) {
+        // Write hit on SHARED: the invalidation broadcast completes within the cycle
+        setLineState(coreId, slot, MODIFIED);
+        if (dataCheck) recordWrite(coreId, address);
+        core.cache.touch(slot);
+        core.hitCount++;
+        totalBusTransactions++;
+        PROFILE_EVENT(core.profile, PROFILE_WRITE_UPGRADE);
+        if (eventLog) {
+            logEvent(cycle, coreId, EVENT_UPGRADE, address, WRITE, SHARED, MODIFIED, BroadCastInvalidate);
+        }
+        LOG_INFO("Core " + std::to_string(coreId) + " WRITE HIT for address " + toHex(address) +
+                 " (state: S -> M, invalidation broadcast)");
+        busOwner = coreId;
+        busTransaction = BroadCastInvalidate;
+        if (splitBus) {
+            // Address phase only
+            splitBus->grantAddressOnly(cycle, cycle - core.busRequestCycle);
+            busNextFree = splitBus->nextGrant();
+            core.busRequestCycle = -1;
+        }
+        retireInstruction(coreId, cycle);
+        return;
+    }
+
+    core.missCount++;
+    PROFILE_EVENT(core.profile, otherCopies == MODIFIED ? PROFILE_WRITE_MISS_M
+                                : otherCopies == EXCLUSIVE ? PROFILE_WRITE_MISS_E
+                                : otherCopies == SHARED ? PROFILE_WRITE_MISS_S : PROFILE_WRITE_MISS_I);
+    LOG_INFO("Core " + std::to_string(coreId) + " WRITE MISS for address " + toHex(address));
+    int stallCycles = 0;
+    if (dirtyOwner != -1) {
+        // Owner writes the block back, then it is read from memory
+        int ownerCycles = writeBelow(coreId, below, address, true);
+        PROFILE_STALL(core.profile, STALL_WRITEBACK, ownerCycles);
+        stallCycles += ownerCycles;
+        cores[dirtyOwner].writebackCount++;
+        cores[dirtyOwner].dataTraffic += blockSize;
+        totalBusTraffic += blockSize;
+        if (estimator) noteRemoteWriteback(dirtyOwner, address);
+    }
+    bool dirtyBelow;
+    int fetchCycles = readBelow(coreId, below + stallCycles, address, dirtyBelow);
+    PROFILE_STALL(core.profile, STALL_MEMORY, fetchCycles);
+    stallCycles += fetchCycles;
+    int latencyCycles = stallCycles;
+    int victimCycles = fillLine(coreId, address, MODIFIED, below + stallCycles);
+    if (dataCheck) recordWrite(coreId, address);
+    PROFILE_STALL(core.profile, STALL_WRITEBACK, victimCycles);
+    stallCycles += victimCycles;
+    core.dataTraffic += blockSize;
+    totalBusTraffic += blockSize;
+    startBusTransaction(coreId, cycle, ReadWithIntentToModify, stallCycles, stallCycles, latencyCycles,
+                        (victimCycles > 0) + (dirtyOwner != -1));
+    if (eventLog) {
+        logEvent(cycle, coreId, EVENT_MISS, address, WRITE, ownState, MODIFIED, ReadWithIntentToModify);
+    }
+    if (dirtyOwner != -1) {
+        totalBusTransactions++; // the write back
+    }
+}
+
+//
+// Event-driven engine: each unfinished core has at most one pending event at its readyCycle,
+// and events are handled in (cycle, core id) order, which is the order the cycle-by-cycle loop
+// visits them. Cycles in which every core is stalled are skipped; their idle time has already
+// been credited by stepCore.
+//
+// Cores stalled on the bus are parked in a min-heap by core id instead of all waking each time
+// the bus frees: at that cycle only the lowest-numbered waiter can win the bus (a lower-numbered
+// running core may beat it), and every other waiter would just stall again until the next release.
+// So only the head waiter holds an event; the rest have their idle time credited when they
+// are woken. This keeps the cost per bus transaction independent of the number of cores.
+//
+void CacheSimulator::runEventLoop() {
+    typedef std::pair<long long, int> Event; // (cycle, core id)
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+    std::priority_queue<int, std::vector<int>, std::greater<int> > busWaiters;
+    int wakingCore = -1; // the waiter holding an event at busNextFree
+
+    // Gives the lowest-numbered waiter an event at the current release of the bus. A new lowest
+    // waiter takes over as head; the old head keeps its event and simply stalls again if it loses.
+    auto wakeHeadWaiter = [&]() {
+        if (busWaiters.empty() || (wakingCore != -1 && busWaiters.top() > wakingCore)) return;
+        PROFILE_SCOPE(profile, PROFILE_BUS_ARBITRATION);
+        wakingCore = busWaiters.top();
+        busWaiters.pop();
+        CoreState &waiter = cores[wakingCore];
+        PROFILE_STALL(waiter.profile, STALL_BUS_BUSY, busNextFree - waiter.readyCycle);
+        waiter.idletime += busNextFree - waiter.readyCycle;
+        waiter.readyCycle = busNextFree;
+        events.push(Event(busNextFree, wakingCore));
+    };
+
+    // Cores left stalled on the bus by an earlier call (a restored checkpoint) park again
+    for (int coreId = 0; coreId < numCores; coreId++) {
+        if (cores[coreId].finished) continue;
+        if (cores[coreId].waitingForBus) {
+            busWaiters.push(coreId);
+        } else {
+            events.push(Event(cores[coreId].readyCycle, coreId));
+        }
+    }
+    wakeHeadWaiter();
+
+    while (!events.empty()) {
+        if (events.top().first > stopAtCycle) {
+            return;
+        }
+        Event ev = events.top();
+        events.pop();
+        int coreId = ev.second;
+        CoreState &core = cores[coreId];
+        if (coreId == wakingCore) {
+            wakingCore = -1;
+        }
+        globalCycle = ev.first;
+        if (globalCycle >= nextIntervalCycle) recordIntervals(globalCycle);
+        stepCore(coreId, globalCycle);
+        wakeHeadWaiter();
+
+        // Keep stepping this core while it stays ahead of every other event (runs of hits)
+        while (!core.finished && !core.waitingForBus && retiredInstructions < stopAtRetired &&
+               core.readyCycle <= stopAtCycle &&
+               (events.empty() || Event(core.readyCycle, coreId) < events.top())) {
+            globalCycle = core.readyCycle;
+            if (globalCycle >= nextIntervalCycle) recordIntervals(globalCycle);
+            stepCore(coreId, globalCycle);
+            wakeHeadWaiter();
+        }
+        if (retiredInstructions >= stopAtRetired) {
+            return; // end of a sampling window; every core resumes from its readyCycle
+        }
+        if (core.waitingForBus) {
+            busWaiters.push(coreId);
+            wakeHeadWaiter();
+        } else if (!core.finished) {
+            events.push(Event(core.readyCycle, coreId));
+        }
+    }
+}
+
+// Reference engine used in debug mode: visits every core on every cycle
+void CacheSimulator::runCycleLoop() {
     while (!std::all_of(cores.begin(), cores.end(), [](const CoreState &cs){ return cs.finished; })) {
-        debugPrint("======= Starting cycle " + std::to_string(globalCycle) + " =======");
-        if (busFree) {
-            debugPrint("Bus is free");
+        globalCycle++;
+        if (globalCycle >= nextIntervalCycle) recordIntervals(globalCycle);
+        LOG_TRACE("======= Starting cycle " + std::to_string(globalCycle) + " =======");
+        if (globalCycle < busNextFree) {
+            LOG_TRACE("Bus is owned by Core " + std::to_string(busOwner));
         } else {
-            debugPrint("Bus is owned by Core " + std::to_string(busOwner));
+            LOG_TRACE("Bus is free");
         }
-        
-        // For this cycle, if the bus is free try to give a turn to one core
-        globalCycle++; //increment global cycle for each cycle
-        bool executed = false;
         for (int coreId = 0; coreId < numCores; coreId++) {
-            cout << "Core " << coreId << " is executing" << endl;
-            // if (globalCycle > busNextFree) {
-            //     busFree = true;
-            //     busOwner = -1;
-            // } // dont free here, owner will free the bus
             CoreState &core = cores[coreId];
-            if (core.finished) {
-                debugPrint("Core " + std::to_string(coreId) + " has finished execution");
+            if (core.finished || core.readyCycle > globalCycle) {
                 continue;
             }
+            stepCore(coreId, globalCycle);
+        }
+        if (retiredInstructions >= stopAtRetired || globalCycle >= stopAtCycle) {
+            return;
+        }
+    }
+}
 
-            // If an instruction is available, process it
-            if (!core.currentLine.empty()) {
-                // If bus is not free, the core idles
-                // if (!busFree) {
-                //     core.idletime++;
-                //     debugPrint("Core " + std::to_string(coreId) + " is stalled waiting for bus (owner: Core " + 
-                //               std::to_string(busOwner) + ")");
-                //     continue;
-                // }
-                
-                // Mark bus busy for this core
-                // busFree = false;
-                // busOwner = coreId;
-                // debugPrint("Core " + std::to_string(coreId) + " acquired bus");
-                
-                std::istringstream iss(core.currentLine);
-                char op;
-                std::string addrStr;
-                iss >> op >> addrStr;
-                unsigned int address = std::stoul(addrStr, nullptr, 16);
-                
-                core.totalInstructions++;
-                debugPrint("Core " + std::to_string(coreId) + " processing: " + op + " " + addrStr);
-                
-                // Process read instruction
-                if (op == 'R') { //one TODO here
-                    core.readCount++;
-                    // Read Hit: if the address is in the core's cache and state is not INVALID
-                    if (core.cache.find(address) != core.cache.end() &&
-                        core.cache[address] != INVALID) {
-                        // Local Read hit: execute in 1 cycle
-                        core.hitCount++;
-                        core.extime += 1;
-                        globalCycle += 1;
-                        
-                        CacheLineState oldState = core.cache[address];
-                        // no state change required for local read hit
-                        debugPrint("Core " + std::to_string(coreId) + " READ HIT for address " + 
-                                  addrStr + " (state: " + stateToString(oldState) + ")");
-                    } else {
-                        // Read Miss, what if present and invalid?
-                        core.missCount++;
-                        debugPrint("Core " + std::to_string(coreId) + " READ MISS for address " + addrStr);
-                        
-                        // First check if any other core has the address
-                        bool foundInOther = false;
-                        int ownerCore = -1;
-                        CacheLineState otherState = INVALID;
-                        
-                        for (int j = 0; j < numCores; j++) { //checking if any other core has the address
-                            if (j == coreId) continue;
-                            if (cores[j].cache.find(address) != cores[j].cache.end() &&
-                                cores[j].cache[address] != INVALID) { //dont want invalid copy
-                                foundInOther = true;
-                                otherState = cores[j].cache[address];
-                                ownerCore = j;
-                                break;
-                            }
-                        }
-                        
-                        totalBusTransactions++;
-                        
-                        if (foundInOther) {
-                            // Cache-to-cache transfer
-                            int transferCycles = 2 * (blockSize / 4); // 2n cycles where n = blockSize/4
-                            
-                            debugPrint("Core " + std::to_string(coreId) + " found data in Core " + 
-                                      std::to_string(ownerCore) + " (state: " + stateToString(otherState) + ")");
-                            
-
-                            switch (otherState)
-                            {
-                                case SHARED: 
-                                {
-                                    // take data from other cache and set own state to shared
-                                    if (busFree) 
-                                    { //bus is free, capture it and send request
-                                        busFree = false;
-                                        busOwner = coreId;
-                                        debugPrint("Core " + std::to_string(coreId) + " acquired bus for cache-to-cache transfer");
-                                        busTransaction = ReadCacheToCache; // i am reading on my readmiss
-                                        busNextFree = globalCycle + transferCycles;
-                                        core.idletime++;
-                                        continue; //sent request just now, so stalling
-                                        break;
-                                    }
-                                    else // bus is busy
-                                    { //bus is not free
-                                        if (busOwner == coreId) // waiting on my own request, to check what type
-                                        {
-                                            if (globalCycle <= busNextFree) //my request not yet served, this logic is correct
-                                                                            // for any case of bus transaction type
-                                            {
-                                                core.idletime++;
-                                                continue;
-                                                break;
-                                            }
-                                            else //my request just served, to check what request was served
-                                            { 
-                                                switch (busTransaction) 
-                                                {
-                                                    case ReadCacheToCache:
-                                                    {
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.cache[address] = SHARED; // check here if need to evict some address
-                                                        core.extime++; //including this here but not very sure
-                                                        //update bus traffic stats
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        break; 
-                                                    }
-                                                    default:
-                                                    {
-                                                        // my other request was served, free the bus
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        continue; // current request in next cycle
-                                                        break;
-                                                    }
-
-                                                }   
-                                            }
-                                        }
-                                        else // i am waiting on someone else's request to be served
-                                        {
-                                            core.idletime++;
-                                            continue;
-                                            break;
-                                        }
-                                    }
-                                    break;
-                                }
-                                case EXCLUSIVE:
-                                {
-                                    if (busFree) //bus is free, capture and send request
-                                    {
-                                        busFree = false;
-                                        busOwner = coreId;
-                                        debugPrint("Core " + std::to_string(coreId) + " acquired bus for cache-to-cache transfer");
-                                        busNextFree = globalCycle + transferCycles;
-                                        core.idletime++;
-                                        continue; //sent request just now, so stalling
-                                        break;
-                                    }
-                                    else //bus is busy, see what request is on the bus
-                                    {
-                                        if (busOwner == coreId) // i am waiting on my own request to be served
-                                        {
-                                            if (globalCycle <= busNextFree) //my request not yet served
-                                            {
-                                                core.idletime++;
-                                                continue;
-                                                break;
-                                            }
-                                            else //my request just served, to check what request was served
-                                            {
-                                                switch (busTransaction) 
-                                                {
-                                                    case ReadCacheToCache:
-                                                    {
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.cache[address] = SHARED; // check here if need to evict some address
-                                                        core.extime++; //including this here but not very sure
-                                                        //update bus traffic stats
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        break; 
-                                                    }
-                                                    default:
-                                                    {
-                                                        // my other request was served, free the bus
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        continue; // current request in next cycle, so continue
-                                                        break;
-                                                    }
-                                                
-                                                }
-                                            }
-                                        }
-
-                                        else //waiting on someone else's request
-                                        {
-                                            core.idletime++;
-                                            continue;
-                                            break;
-                                        }
-                                    }
-                                    break;
-                                }
-                                case MODIFIED:
-                                {
-                                    if (busFree) //bus is free, take control and send request
-                                    {
-                                        busFree = false;
-                                        busOwner = coreId;
-                                        debugPrint("Core " + std::to_string(coreId) + " acquired bus for cache-to-cache transfer");
-                                        busNextFree = globalCycle + transferCycles;
-                                        core.idletime++;
-                                        continue; //sent request just now, so stalling
-                                        break;
-                                    }
-                                    else //bus busy, one TODO here
-                                    {
-                                        if (busOwner == coreId) // i am waiting on my own request to be served
-                                        {
-                                            if (globalCycle <= busNextFree) //my request not yet served
-                                            {
-                                                core.idletime++;
-                                                continue;
-                                                break;
-                                            }
-                                            else //my request just served, see which request was served
-                                            {
-                                                switch (busTransaction)
-                                                {
-                                                    case ReadCacheToCache:
-                                                    {
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.cache[address] = SHARED;
-                                                        core.extime++; //including this here but not very sure
-                                                        //update bus traffic stats
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        // have to write owner's copy back to memory
-                                                        int memAccessCycles = 100;
-                                                        busFree = false;
-                                                        busOwner = ownerCore;
-                                                        busNextFree = globalCycle + memAccessCycles;
-                                                        busTransaction = WriteBackOnOtherReadMiss;
-                                                        // some eviction logic, stats, etc.
-                                                        continue;
-                                                        break;
-                                                    }
-                                                    default:
-                                                    {
-                                                        // my other request was served, free the bus
-                                                        busFree = true;
-                                                        busOwner = -1;
-                                                        core.dataTraffic += blockSize;
-                                                        totalBusTraffic += blockSize;
-                                                        continue; // current request in next cycle, so continue
-                                                        break;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        else //waiting on someone else's request
-                                        {
-                                            core.idletime++;
-                                            continue;
-                                            break;
-                                        }
-                                    }
-                                    break;
-                                }
-                            }
-
-                            // Extra cycle when data comes from an E or M state
-                            // if (otherState == EXCLUSIVE || otherState == MODIFIED) {
-                            //     transferCycles += 1;
-                            //     debugPrint("Extra cycle for E/M state transfer");
-                            // }
-                            
-                            // core.extime += transferCycles + 1; // +1 for execution after transfer
-                            // globalCycle += transferCycles + 1;
-                            
-                            // // After transfer, mark line in requester as SHARED
-                            // core.cache[address] = SHARED;
-                            
-                            // // If source was E or M, change it to S too
-                            // if (otherState == EXCLUSIVE || otherState == MODIFIED) {
-                            //     cores[ownerCore].cache[address] = SHARED;
-                            //     debugPrint("Core " + std::to_string(ownerCore) + " state changed to SHARED");
-                            // }
-                            
-                            // // Update bus traffic statistics
-                            // core.dataTraffic += blockSize;
-                            // totalBusTraffic += blockSize;
-                            
-                            // debugPrint("Cache-to-cache transfer complete (took " + 
-                            //           std::to_string(transferCycles) + " cycles)");
-                            // debugPrint("Core " + std::to_string(coreId) + " state now SHARED");
-                        } 
-                        else {
-                            // Data not found in any other cache: fetch from memory
-                            int memAccessCycles = 100;
-                            // core.idletime += memAccessCycles; //+100 for idle cycle
-                            // core.extime += 1;
-                            
-                            if (!busFree) // bus is busy
-                            {
-                                if (busOwner == coreId) { //i am the owner and waiting on my request
-                                    if (globalCycle <= busNextFree) //my request not yet complete
-                                    {
-                                        core.idletime++; //stall and move on
-                                        continue;
-                                    } 
-                                    else //my request just completed, check to see which request was served
-                                    {
-                                        switch (busTransaction)
-                                        {
-                                            case ReadFromMem:
-                                            {
-                                                busFree = true;
-                                                busOwner = -1;
-                                                core.cache[address] = EXCLUSIVE;
-                                                core.extime++; //including this here but not very sure
-                                                //update bus traffic stats
-                                                core.dataTraffic += blockSize;
-                                                totalBusTraffic += blockSize;
-                                                break;
-                                            }
-                                            default:
-                                            {
-                                                // my other request was served, free the bus
-                                                busFree = true;
-                                                busOwner = -1;
-                                                core.dataTraffic += blockSize;
-                                                totalBusTraffic += blockSize;
-                                                continue; // current request in next cycle, so continue
-                                                break;
-                                            }
-                                        }
-                                    }
-                                } 
-                                else 
-                                { //bus is busy due someone else's request
-                                    core.idletime++;
-                                    continue;
-                                }
-                            } 
-                            else  //bus is free to capture
-                            { //take ownership of bus and send request
-                                busFree = false;
-                                busOwner = coreId;
-                                busTransaction = ReadFromMem;
-                                busNextFree = globalCycle + memAccessCycles;
-                                core.idletime++; //including idle time here though not very sure
-                                continue;
-                            }
-                     // ********// globalCycle += memAccessCycles + 1;********
-                            
-                            // Set state to EXCLUSIVE, this to do when we get data from memory, for now processor should stall
-                            // core.cache[address] = EXCLUSIVE;
-                            // core.dataTraffic += blockSize;
-                            // totalBusTraffic += blockSize;
-                        }
-                    }
+// Barrier for the parallel engine: spins briefly, then yields while waiting for the last arrival
+class SpinBarrier {
+private:
+    const int count;
+    std::atomic<int> waiting;
+    std::atomic<int> generation;
+
+public:
+    explicit SpinBarrier(int count) : count(count), waiting(0), generation(0) {}
+    void wait() {
+        int gen = generation.load(std::memory_order_acquire);
+        if (waiting.fetch_add(1, std::memory_order_acq_rel) == count - 1) {
+            waiting.store(0, std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        for (int spins = 0; generation.load(std::memory_order_acquire) == gen; spins++) {
+            if (spins > 1000) std::this_thread::yield();
+        }
+    }
+};
+
+// A core's bus request, raised in the cycle it found it needed the bus
+struct BusRequest {
+    long long cycle;
+    int coreId;
+    bool operator<(const BusRequest &other) const {
+        return cycle != other.cycle ? cycle < other.cycle : coreId < other.coreId;
+    }
+};
+
+void CacheSimulator::setParallel(int numThreads, int quantum) {
+    if (numThreads < 1 || quantum < 1) {
+        throw std::invalid_argument("parallel mode needs at least one thread and a quantum of at least one cycle");
+    }
+    if (debugMode) {
+        throw std::invalid_argument("parallel mode cannot be combined with debug mode");
+    }
+    if (sampling.enabled()) {
+        throw std::invalid_argument("sampling is not supported in parallel mode");
+    }
+    parallelThreads = numThreads;
+    quantumCycles = quantum;
+}
+
+//
+// Quantum-synchronized parallel engine. Each worker thread owns a contiguous group of cores and
+// advances them independently up to the end of the current quantum: hits and retirements only
+// touch a core's own cache and counters. A core that needs the bus queues a request on its
+// thread's queue and blocks. At the barrier one thread merges the queues and arbitrates the bus
+// exactly as the serial engines do (at each release the lowest-numbered requester wins) for
+// every grant that falls inside the quantum; later grants carry over to the next barrier. Cores
+// granted the bus keep running there, serially and in cycle order between the grants, until the
+// end of the quantum: a core completes its transaction and issues its dependent accesses (the
+// write after the read that fetched the line) before the bus goes to a later requester.
+//
+// The approximation: cores that did not need the bus have already run to the end of the quantum,
+// so they see the coherence effects of a transaction only from the next quantum on and may hit
+// on a line the serial engines would already have invalidated.
+//
+void CacheSimulator::runParallel() {
+    int numThreads = std::max(1, std::min(parallelThreads, numCores));
+    std::vector<std::vector<BusRequest> > queues(numThreads);
+    std::vector<BusRequest> pending; // raised but not yet granted, carried across barriers
+    std::vector<BusRequest> deferred;
+    std::vector<int> granted;        // cores granted the bus in the current resolveBus
+    SpinBarrier barrier(numThreads);
+    long long quantumEnd = 1 + quantumCycles; // cycles [quantumEnd - quantumCycles, quantumEnd)
+    bool done = std::all_of(cores.begin(), cores.end(), [](const CoreState &cs){ return cs.finished; });
+
+    // One step of a core that is not waiting for the bus: retires its pending instruction or runs
+    // the next one as a hit. Returns false, with the core waiting, when that one needs the bus.
+    auto stepAhead = [&](int coreId) {
+        CoreState &core = cores[coreId];
+        long long cycle = core.readyCycle;
+        if (core.pendingComplete) {
+            core.pendingComplete = false;
+            retireInstruction(coreId, cycle);
+            return true;
+        }
+        int slot;
+        if (executeHit(coreId, cycle, slot)) {
+            return true;
+        }
+        core.waitingForBus = true;
+        return false;
+    };
+
+    auto advanceCores = [&](int thread) {
+        int first = (int)((long long)numCores * thread / numThreads);
+        int last = (int)((long long)numCores * (thread + 1) / numThreads);
+        for (int coreId = first; coreId < last; coreId++) {
+            CoreState &core = cores[coreId];
+            while (!core.finished && !core.waitingForBus && core.readyCycle < quantumEnd) {
+                long long cycle = core.readyCycle;
+                if (!stepAhead(coreId)) {
+                    BusRequest request = { cycle, coreId };
+                    queues[thread].push_back(request);
                 }
-                // Process write instruction
-                else if (op == 'W') {
-                    core.writeCount++;
-                    // Write Hit, all actions will be instantaneous
-                    if (core.cache.find(address) != core.cache.end() &&
-                        core.cache[address] != INVALID) {
-                        core.hitCount++;
-                        CacheLineState ownState = core.cache[address];
-                        
-                        debugPrint("Core " + std::to_string(coreId) + " WRITE HIT for address " + 
-                                  addrStr + " (state: " + stateToString(ownState) + ")");
-                        
-                        // If state is SHARED, send invalidations to other cores
-                        if (ownState == SHARED) {
-                            debugPrint("Sending invalidations to other cores with SHARED copies");
-                            totalBusTransactions++;
-                            
-                            for (int j = 0; j < numCores; j++) { //assuming this operation is instantaneously happening
-                                if (j == coreId) continue;
-                                if (cores[j].cache.find(address) != cores[j].cache.end() &&
-                                    cores[j].cache[address] != INVALID) {
-                                    // Invalidate other core's copy
-                                    CacheLineState prevState = cores[j].cache[address];
-                                    cores[j].cache[address] = INVALID;
-                                    totalInvalidations++;
-                                    cores[j].busInvalidations++; // what is this?
-                                    core.dataTraffic += blockSize;
-                                    totalBusTraffic += blockSize;
-                                    
-                                    debugPrint("Invalidated Core " + std::to_string(j) + 
-                                              " copy (was " + stateToString(prevState) + ")");
-                                }
-                            }
-                            // Then update own state to MODIFIED
-                            core.cache[address] = MODIFIED;
-                            core.extime += 1;
-                            // globalCycle += 1;
-                            
-                            debugPrint("Core " + std::to_string(coreId) + " state changed to MODIFIED");
-                        } else if (ownState == EXCLUSIVE) {
-                            // Write hit in EXCLUSIVE state takes 1 cycle, becomes MODIFIED, no need to send invalidate
-                            core.extime += 1;
-                            // globalCycle += 1;
-                            core.cache[address] = MODIFIED;
-                            
-                            debugPrint("Core " + std::to_string(coreId) + 
-                                      " state changed from EXCLUSIVE to MODIFIED");
-                        } else if (ownState == MODIFIED) {
-                            // Write hit in MODIFIED state takes 1 cycle
-                            core.extime += 1;
-                            // globalCycle += 1;
-                            debugPrint("Core " + std::to_string(coreId) + 
-                                      " remains in MODIFIED state");
-                        }
-                    } else { //some operations will take bus access, handle accordingly, write miss
-                        // Local Write Miss Happened
-                        core.missCount++;
-                        debugPrint("Core " + std::to_string(coreId) + " WRITE MISS for address " + addrStr);
-                        totalBusTransactions++;
-                        
-                        // Invalidate copies from other caches, if any
-                        bool foundInOther = false;
-                        bool canProceed = true;
-                        for (int j = 0; j < numCores; j++) {
-                            if (j == coreId) continue;
-                            if (cores[j].cache.find(address) != cores[j].cache.end() &&
-                                cores[j].cache[address] != INVALID) {
-                                foundInOther = true;
-                                int ownerCore = j;
-                                CacheLineState prevState = cores[j].cache[address];
-                                switch (prevState) 
-                                {
-                                    case SHARED:
-                                    {
-                                        //find all shared blocks, and invalidate their copies
-                                        vector<int> sharedCoreIndices;
-                                        for (int j = 0; j < numCores; j++) {
-                                            if (j==coreId) continue;
-                                            if (cores[j].cache.find(address) != cores[j].cache.end() &&
-                                                cores[j].cache[address] != INVALID) {
-                                                if (cores[j].cache[address] == SHARED) 
-                                                    sharedCoreIndices.push_back(j);  // Store index, not the object
-                                                }            
-                                        }
-                                        if (busFree) //bus is free, capture it and send req to memory
-                                        {
-                                            int memAccessCycles = 100;
-                                            busFree = false;
-                                            busOwner = coreId;
-                                            busNextFree = globalCycle + memAccessCycles;
-                                            busTransaction = ReadWithIntentToModify;
-                                            totalBusTransactions++;
-                                        }
-                                        else //bus is busy
-                                        {
-                                            if (busOwner == coreId) // i am waiting on my own request
-                                            {
-                                                if (globalCycle <= busNextFree) //my req not processed yet
-                                                {
-                                                    core.idletime ++;
-                                                    continue;
-                                                }
-                                                else //my req just processed, see which one
-                                                {
-                                                    switch (busTransaction) //useless to check
-                                                    { 
-                                                        case ReadWithIntentToModify:
-                                                        {
-                                                            busFree = true;
-                                                            busOwner = -1;
-                                                            core.cache[address] = MODIFIED;
-                                                            //key request processed, set other owner to I, and my copy to M
-                                                            cores[ownerCore].cache[address] = INVALID;
-                                                            core.dataTraffic += blockSize;
-                                                            totalBusTraffic += blockSize;
-                                                            break;
-                                                        }
-                                                        default:
-                                                        {
-                                                            busFree = true;
-                                                            busOwner = -1;
-                                                            core.dataTraffic += blockSize;
-                                                            totalBusTraffic += blockSize;
-                                                            continue; // current request in next cycle, so continue
-                                                            break;
-                                                        }
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        for (auto idx : sharedCoreIndices) {
-                                            assert(cores[idx].cache[address] == SHARED);
-                                            cores[idx].cache[address] = INVALID;
-                                        } //done, all shared blocks set to invalid
-                                        break;
-                          }
-                                    case EXCLUSIVE:
-                                    { //have to fetch data from memory
-                                        // broadcast signal rwitm, other cache will invalidate their copy
-                                        if (busFree) //bus is free, capture it and send req to memory
-                                        {
-                                            int memAccessCycles = 100;
-                                            busFree = false;
-                                            busOwner = coreId;
-                                            busNextFree = globalCycle + memAccessCycles;
-                                            busTransaction = ReadWithIntentToModify;
-                                            totalBusTransactions++;
-                                        }
-                                        else //bus is busy
-                                        {
-                                            if (busOwner == coreId) // i am waiting on my own request
-                                            {
-                                                if (globalCycle <= busNextFree) //my req not processed yet
-                                                {
-                                                    core.idletime ++;
-                                                    continue;
-                                                }
-                                                else //my req just processed, see which one
-                                                {
-                                                    switch (busTransaction) 
-                                                    { 
-                                                        case ReadWithIntentToModify:
-                                                        {
-                                                            busFree = true;
-                                                            busOwner = -1;
-                                                            core.cache[address] = MODIFIED;
-                                                            //key request processed, set other owner to I, and my copy to M
-                                                            cores[ownerCore].cache[address] = INVALID;
-                                                            core.dataTraffic += blockSize;
-                                                            totalBusTraffic += blockSize;
-                                                            break;
-                                                        }
-                                                        default: // my other requests were served, free the bus for now
-                                                        {
-                                                            busFree = true;
-                                                            busOwner = -1;
-                                                            core.dataTraffic += blockSize;
-                                                            totalBusTraffic += blockSize;
-                                                            continue; // current request in next cycle, so continue
-                                                            break;
-                                                        }
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        
-                                        // assert(cores[ownerCore].cache[address] == INVALID);
-                                        //some invalidation stats
-                                        break;
-                                    }
-                                    case MODIFIED:
-                                    {
-                                        // write back from owner cache to memory
-                                        // next implement copy from memory and write into current cache
-                                        if (!busFree)
-                                        {
-                                            core.idletime++;
-                                            canProceed = false; // 
-                                            break;
-                                        }
-                                        busFree = false;
-                                        busOwner = ownerCore;
-                                        busNextFree = globalCycle + 100; //100 cycles to write back to memory
-                                        busTransaction = WriteBackOnOtherWriteMiss;
-                                        cores[ownerCore].cache[address] = INVALID; // invalidate the copy in owner core, 
-                                         //strictly this should be done after the bus is freed, but ig ok for now
-                                        totalBusTransactions++;
-                                        break;
-                                    }
-                                }
-                                
-                                debugPrint("Invalidated Core " + std::to_string(j) + 
-                                          " copy (was " + stateToString(prevState) + ")");
-                            }
-                        }
-                        if (!canProceed) continue; // cant issue request, move on
-                        // Fetch data from memory, didnt find in any other cache
-                        int memAccessCycles = 100;
-                        // assert(!foundInOther);
-                        if (busFree) //bus is free, capture it and send req to memory
-                        {
-                            busFree = false;
-                            busOwner = coreId;
-                            busNextFree = globalCycle + memAccessCycles;
-                        }
-                        else //bus is busy
-                        {
-                            if (busOwner == coreId) // i am waiting on my own request
-                            {
-                                if (globalCycle <= busNextFree) //my req not processed yet
-                                {
-                                    core.idletime ++;
-                                    continue;
-                                }
-                                else //my req just processed
-                                {
-                                    busFree = true;
-                                    busOwner = -1;
-                                    core.cache[address] = MODIFIED;
-                                    core.dataTraffic += blockSize;
-                                    core.extime++;
-                                    totalBusTraffic += blockSize;
-                                }
-                            }
-                            else //i am waiting on someone else's req
-                            {
-                                core.idletime ++;
-                                continue;
-                            }
+            }
+        }
+    };
+
+    // Serial part, between the two barriers of a quantum
+    auto resolveBus = [&]() {
+        for (std::vector<BusRequest> &queue : queues) {
+            pending.insert(pending.end(), queue.begin(), queue.end());
+            queue.clear();
+        }
+        std::sort(pending.begin(), pending.end());
+
+        std::priority_queue<int, std::vector<int>, std::greater<int> > eligible; // core ids
+        granted.clear();
+        size_t next = 0;
+        long long t = busNextFree;
+        while (true) {
+            // A core granted in this pass that is due before the next grant runs first, so its
+            // transaction completes and its next accesses happen before the bus moves on
+            long long grantAt = LLONG_MAX;
+            if (!eligible.empty()) grantAt = t;
+            else if (next < pending.size()) grantAt = std::max(t, pending[next].cycle);
+            int runner = -1;
+            for (int coreId : granted) {
+                const CoreState &core = cores[coreId];
+                if (!core.finished && !core.waitingForBus && core.readyCycle < quantumEnd &&
+                    core.readyCycle <= grantAt && (runner < 0 || std::make_pair(core.readyCycle, coreId) <
+                                                                 std::make_pair(cores[runner].readyCycle, runner))) {
+                    runner = coreId;
+                }
+            }
+            if (runner >= 0) {
+                long long cycle = cores[runner].readyCycle;
+                if (!stepAhead(runner)) {
+                    BusRequest request = { cycle, runner };
+                    pending.insert(std::upper_bound(pending.begin() + next, pending.end(), request), request);
+                }
+                continue;
+            }
+            if (grantAt >= quantumEnd) break;
+            t = grantAt;
+            while (next < pending.size() && pending[next].cycle <= t) {
+                eligible.push(pending[next++].coreId);
+            }
+            int coreId = eligible.top();
+            eligible.pop();
+            CoreState &core = cores[coreId];
+            PROFILE_STALL(core.profile, STALL_BUS_BUSY, t - core.readyCycle);
+            core.idletime += t - core.readyCycle; // readyCycle is still the cycle of the request
+            if (splitBus && core.busRequestCycle < 0) core.busRequestCycle = core.readyCycle;
+            stepCore(coreId, t);                  // the bus is free at t: starts the transaction
+            if (std::find(granted.begin(), granted.end(), coreId) == granted.end()) {
+                granted.push_back(coreId);
+            }
+            t = std::max(t, busNextFree);
+        }
+
+        for (CoreState &core : cores) {
+            retiredInstructions += core.retiredInQuantum;
+            core.retiredInQuantum = 0;
+        }
+
+        deferred.clear();
+        while (!eligible.empty()) {
+            int coreId = eligible.top();
+            eligible.pop();
+            BusRequest request = { cores[coreId].readyCycle, coreId };
+            deferred.push_back(request);
+        }
+        deferred.insert(deferred.end(), pending.begin() + next, pending.end());
+        pending.swap(deferred);
+
+        // Next quantum, skipping ahead over cycles in which nothing can happen
+        long long earliest = -1;
+        for (const CoreState &core : cores) {
+            if (!core.finished && !core.waitingForBus && (earliest < 0 || core.readyCycle < earliest)) {
+                earliest = core.readyCycle;
+            }
+        }
+        for (const BusRequest &request : pending) {
+            long long grant = std::max(busNextFree, request.cycle);
+            if (earliest < 0 || grant < earliest) earliest = grant;
+        }
+        done = (earliest < 0);
+        quantumEnd = (earliest >= quantumEnd) ? earliest + quantumCycles : quantumEnd + quantumCycles;
+    };
+
+    auto worker = [&](int thread) {
+        while (!done) {
+            advanceCores(thread);
+            barrier.wait();
+            if (thread == 0) resolveBus();
+            barrier.wait();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < numThreads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (std::thread &t : pool) {
+        t.join();
+    }
+
+    // Cycle of the last retirement, as the serial engines report it
+    globalCycle = 0;
+    for (const CoreState &core : cores) {
+        globalCycle = std::max(globalCycle, core.readyCycle - 1);
+    }
+}
+
+//
+// Sampled simulation
+//
+void CacheSimulator::setSampling(const SamplingConfig& config) {
+    if (config.setSampling() && config.intervalSampling()) {
+        throw std::invalid_argument("set sampling and interval sampling cannot be combined");
+    }
+    if (config.setRatio < 1 || config.setRatio > numSets) {
+        throw std::invalid_argument("set sampling ratio must be between 1 and the number of sets");
+    }
+    if (parallelThreads > 0 && config.enabled()) {
+        throw std::invalid_argument("sampling is not supported in parallel mode");
+    }
+    sampling = config;
+    estimator.reset();
+    if (!config.enabled()) return;
+
+    estimator.reset(new SampleEstimator(numCores + 1));
+    if (config.setSampling()) {
+        for (int set = 0; set < numSets; set += config.setRatio) {
+            estimator->addUnit(); // unit set / setRatio
+        }
+    }
+}
+
+// Estimator unit an access to address is attributed to, or -1 if it is not measured
+int CacheSimulator::sampleUnitOf(uint64_t address) const {
+    if (!sampling.setSampling()) {
+        return windowUnit;
+    }
+    int set = (int)((address >> blockBits) & (uint64_t)(numSets - 1));
+    return (set % sampling.setRatio == 0) ? set / sampling.setRatio : -1;
+}
+
+// Retires the core's references to unsampled sets in zero cycles. Returns true if the trace ended.
+bool CacheSimulator::skipUnsampled(int coreId) {
+    CoreState &core = cores[coreId];
+    while (sampleUnitOf(core.chunk[core.chunkPos].address) < 0) {
+        core.totalInstructions++;
+        if (core.chunk[core.chunkPos].op == READ) core.readCount++;
+        else core.writeCount++;
+        core.extime++;
+        retiredInstructions++;
+        advanceTrace(coreId);
+        if (core.finished) return true;
+    }
+    return false;
+}
+
+// Credits everything the core's counters gained during the instruction now retiring to its unit
+void CacheSimulator::attributeRetirement(int coreId) {
+    CoreState &core = cores[coreId];
+    long long now[NUM_SAMPLED_STATS];
+    readSampledCounters(core, now);
+    int unit = sampleUnitOf(core.chunk[core.chunkPos].address);
+    if (unit >= 0) {
+        for (int stat = 0; stat < NUM_SAMPLED_STATS; stat++) {
+            estimator->add(unit, coreId, stat, now[stat] - core.sampledAtStart[stat]);
+        }
+        estimator->add(unit, coreId, SAMPLED_REFERENCES, 1);
+        estimator->add(unit, numCores, SAMPLED_REFERENCES, 1);
+    }
+    std::copy(now, now + NUM_SAMPLED_STATS, core.sampledAtStart);
+}
+
+// A write back forced on another core belongs to the request that caused it, not to whatever
+// that core is executing
+void CacheSimulator::noteRemoteWriteback(int ownerId, uint64_t address) {
+    CoreState &owner = cores[ownerId];
+    owner.sampledAtStart[SAMPLED_WRITEBACKS]++;
+    owner.sampledAtStart[SAMPLED_TRAFFIC] += blockSize;
+    int unit = sampleUnitOf(address);
+    if (unit >= 0) {
+        estimator->add(unit, ownerId, SAMPLED_WRITEBACKS, 1);
+        estimator->add(unit, ownerId, SAMPLED_TRAFFIC, blockSize);
+    }
+}
+
+// Functional execution (warming, fast-forward): applies the core's current reference to the caches
+// and the coherence state, counted like the detailed engines count it but with no bus and no
+// timing, and moves on
+void CacheSimulator::functionalAccess(int coreId) {
+    CoreState &core = cores[coreId];
+    const TraceRecord &record = core.chunk[core.chunkPos];
+    uint64_t address = record.address;
+    int slot = core.cache.findLine(address);
+    CacheLineState ownState = (slot < 0) ? INVALID : core.cache.getState(slot);
+
+    core.totalInstructions++;
+    core.extime++;
+    retiredInstructions++;
+    if (ownState == INVALID) {
+        core.missCount++;
+    } else {
+        core.hitCount++;
+    }
+    if (record.op == READ) {
+        core.readCount++;
+        if (ownState != INVALID) {
+            core.cache.touch(slot);
+        } else {
+            int entry = directory.find(address >> blockBits);
+            bool shared = (entry >= 0);
+            if (shared && directory.owner(entry) >= 0) {
+                int owner = directory.owner(entry);
+                int ownerSlot = cores[owner].cache.findLine(address);
+                bool dirty = (cores[owner].cache.getState(ownerSlot) == MODIFIED);
+                setLineState(owner, ownerSlot, SHARED);
+                if (dirty) {
+                    cores[owner].writebackCount++;
+                    writeBelow(coreId, globalCycle, address, true);
+                }
+            }
+            bool dirtyBelow = false;
+            if (!shared) readBelow(coreId, globalCycle, address, dirtyBelow);
+            fillLine(coreId, address, shared ? SHARED : (dirtyBelow ? MODIFIED : EXCLUSIVE), globalCycle);
+        }
+        if (dataCheck) checkRead(coreId, address);
+    } else {
+        core.writeCount++;
+        if (ownState == SHARED || ownState == INVALID) {
+            int entry = directory.find(address >> blockBits);
+            if (entry >= 0 && directory.sharerCount(entry) > (ownState == SHARED ? 1 : 0)) {
+                core.busInvalidations++;
+                directory.copySharers(entry, sharerScratch);
+                for (size_t w = 0; w < sharerScratch.size(); w++) {
+                    for (uint64_t bits = sharerScratch[w]; bits != 0; bits &= bits - 1) {
+                        int j = (int)(w * 64) + __builtin_ctzll(bits);
+                        if (j == coreId) continue;
+                        int otherSlot = cores[j].cache.findLine(address);
+                        bool dirty = (cores[j].cache.getState(otherSlot) == MODIFIED);
+                        setLineState(j, otherSlot, INVALID);
+                        if (dirty) {
+                            cores[j].writebackCount++;
+                            writeBelow(coreId, globalCycle, address, true);
                         }
-                        // core.extime += memAccessCycles + 1;
-                        // globalCycle += memAccessCycles + 1;
-                        
-                        // Update bus traffic for memory fetch
-                        // core.dataTraffic += blockSize;
-                        // totalBusTraffic += blockSize;
-                        
-                        // After write miss, update own state to MODIFIED
-                        // assert(core.cache[address] == MODIFIED);
-                        
-                        debugPrint("Memory fetch and modify complete (took " + 
-                                  std::to_string(memAccessCycles+1) + " cycles)");
-                        debugPrint("Core " + std::to_string(coreId) + " state now MODIFIED");
                     }
                 }
-                
-                // Mark bus as free
-                assert(busFree = true); // bus should be free if reached here
-                // busFree = true;
-                debugPrint("Core " + std::to_string(coreId) + " released the bus");
-                busOwner = -1;
-                executed = true;
-                
-                // Read next line for this core
-                if (!std::getline(*core.trace, core.currentLine)) {
-                    core.finished = true;
-                    debugPrint("Core " + std::to_string(coreId) + " has no more instructions");
-                } else {
-                    debugPrint("Core " + std::to_string(coreId) + " next instruction: " + core.currentLine);
+            }
+        }
+        if (ownState == INVALID) {
+            bool dirtyBelow;
+            readBelow(coreId, globalCycle, address, dirtyBelow);
+            fillLine(coreId, address, MODIFIED, globalCycle);
+        } else {
+            if (ownState != MODIFIED) setLineState(coreId, slot, MODIFIED);
+            core.cache.touch(slot);
+        }
+        if (dataCheck) recordWrite(coreId, address);
+    }
+    advanceTrace(coreId);
+}
+
+//
+// SMARTS-style interval sampling: detailed windows of the serial engine, each an estimator unit,
+// separated by functional warming. Every window after the first starts with an unmeasured
+// detailed warm-up, which brings the bus queue and the relative progress of the cores back to
+// a timed state after warming. Requests granted the bus when the window closes retire inside
+// it; stalls that cross either end of the window are charged with the part inside it.
+// Warming takes no simulated time and interleaves the cores in proportion to the references
+// each retired in the last warm-up and window, so that they drift apart as in the timed run
+// (one for one would keep them in lockstep and overstate sharing misses).
+//
+void CacheSimulator::runIntervalSampling() {
+    auto allFinished = [&]() {
+        return std::all_of(cores.begin(), cores.end(), [](const CoreState &cs){ return cs.finished; });
+    };
+    auto runDetailed = [&](long long refs) {
+        stopAtRetired = retiredInstructions + refs;
+        if (debugMode) {
+            runCycleLoop();
+        } else {
+            runEventLoop();
+        }
+        stopAtRetired = LLONG_MAX;
+    };
+    // Sampled counters at the start of cycle, stalls cut at it as in snapshotInterval
+    auto countersAt = [&](const CoreState &core, long long cycle, long long *values) {
+        readSampledCounters(core, values);
+        if (!core.finished && (core.readyCycle > cycle || core.waitingForBus)) {
+            values[SAMPLED_IDLE_CYCLES] += cycle - core.readyCycle;
+        }
+    };
+    std::vector<long long> startRefs(numCores);
+    std::vector<double> rate(numCores);  // references retired per detailed phase
+    std::vector<double> pass(numCores);  // stride scheduling of the warming
+    while (!allFinished()) {
+        for (int coreId = 0; coreId < numCores; coreId++) {
+            startRefs[coreId] = cores[coreId].totalInstructions;
+        }
+        // The first window needs no warm-up and, holding the cold start, is counted as it is
+        bool first = (estimator->units() == 0);
+        if (sampling.warmupRefs > 0 && !first) {
+            runDetailed(sampling.warmupRefs);
+            if (allFinished()) break;
+        }
+        windowUnit = estimator->addUnit(first);
+        long long windowStart = globalCycle;
+        for (CoreState &core : cores) {
+            countersAt(core, windowStart, core.sampledAtStart);
+        }
+        runDetailed(sampling.detailedRefs);
+        for (int coreId = 0; coreId < numCores; coreId++) {
+            CoreState &core = cores[coreId];
+            if (!core.finished && core.pendingComplete) {
+                core.pendingComplete = false;
+                globalCycle = std::max(globalCycle, core.readyCycle);
+                retireInstruction(coreId, core.readyCycle);
+            }
+        }
+        // Cores still stalled are charged to the window for the part of the stall inside it
+        for (int coreId = 0; coreId < numCores; coreId++) {
+            CoreState &core = cores[coreId];
+            if (core.finished) continue;
+            long long now[NUM_SAMPLED_STATS];
+            countersAt(core, globalCycle, now);
+            for (int stat = 0; stat < NUM_SAMPLED_STATS; stat++) {
+                estimator->add(windowUnit, coreId, stat, now[stat] - core.sampledAtStart[stat]);
+            }
+        }
+        estimator->add(windowUnit, numCores, SAMPLED_ELAPSED_CYCLES, globalCycle - windowStart);
+        windowUnit = -1;
+        settleBusWaiters();
+
+        for (int coreId = 0; coreId < numCores; coreId++) {
+            // One more, so that a core stalled through the window still creeps forward
+            rate[coreId] = (double)(cores[coreId].totalInstructions - startRefs[coreId]) + 1.0;
+            pass[coreId] = 0.0;
+        }
+        for (long long warmed = 0; warmed < sampling.warmingRefs; warmed++) {
+            int next = -1;
+            for (int coreId = 0; coreId < numCores; coreId++) {
+                if (!cores[coreId].finished && (next < 0 || pass[coreId] < pass[next])) {
+                    next = coreId;
                 }
             }
+            if (next < 0) break;
+            functionalAccess(next);
+            pass[next] += 1.0 / rate[next];
+        }
+        for (CoreState &core : cores) {
+            core.waitingForBus = false;
+            core.busRequestCycle = -1;
+            core.readyCycle = std::max(core.readyCycle, globalCycle + 1);
         }
-        
-        // If no core executed (e.g., all waiting for the bus), advance the clock
-        // if (!executed) {
-        //     globalCycle++;
-        //     debugPrint("No execution this cycle, advancing global clock");
-        //     for (int coreId = 0; coreId < numCores; coreId++) {
-        //         if (!cores[coreId].finished) {
-        //             cores[coreId].idletime++;
-        //             debugPrint("Core " + std::to_string(coreId) + " idle time increased");
-        //         }
-        //     }
-        // }
     }
-    
+}
+
+// Population total of a sampled statistic, scaled up from the sampled references of its row to
+// all references of that core (or of every core for the bus row)
+SampleEstimate CacheSimulator::estimated(int row, int stat) const {
+    double references = (row < numCores) ? (double)cores[row].totalInstructions : (double)retiredInstructions;
+    return estimator->estimate(row, stat, references);
+}
+
+void CacheSimulator::setFastForward(long long refsPerCore) {
+    if (refsPerCore < 0) {
+        throw std::invalid_argument("fast-forward reference count must not be negative");
+    }
+    fastForwardRefs = refsPerCore;
+}
+
+//
+// Functional fast-forward: the first fastForwardRefs references of every core only update the
+// caches and the coherence state, one reference per core in turn. There is no bus arbitration,
+// no stall and no cycle. What the counters gathered moves to the fast-forward statistics, so the
+// detailed engines start at cycle 0 with warm caches and zero counters.
+//
+void CacheSimulator::runFastForward() {
+    for (long long n = 0; n < fastForwardRefs; n++) {
+        bool active = false;
+        for (int coreId = 0; coreId < numCores; coreId++) {
+            if (!cores[coreId].finished) {
+                functionalAccess(coreId);
+                active = true;
+            }
+        }
+        if (!active) break;
+    }
+
+    for (CoreState &core : cores) {
+        FastForwardStats &ff = core.fastForward;
+        ff.instructions = core.totalInstructions;
+        ff.reads = core.readCount;
+        ff.writes = core.writeCount;
+        ff.misses = core.missCount;
+        ff.evictions = core.evictionCount;
+        ff.writebacks = core.writebackCount;
+        ff.invalidations = core.busInvalidations;
+        core.totalInstructions = core.readCount = core.writeCount = core.hitCount = core.missCount = 0;
+        core.evictionCount = core.writebackCount = core.busInvalidations = core.dataTraffic = 0;
+        core.extime = 0;
+    }
+    totalBusTraffic = 0;     // write backs of dirty victims
+    totalBusTransactions = 0;
+    retiredInstructions = 0;
+    if (l2) {
+        // The L2 keeps its contents; its counters, like the L1s', start with the detailed part
+        l2->stats = SharedCacheStats();
+        l2->resetTiming();
+    }
+    LOG_INFO("Fast-forwarded " + std::to_string(fastForwardRefs) + " references per core");
+}
+
+//
+// Interval time series
+//
+void CacheSimulator::setIntervalStats(const std::string& fileName, int cycles) {
+    if (fileName.empty() || cycles <= 0) {
+        throw std::invalid_argument("interval statistics need a file name and an interval of at least one cycle");
+    }
+    intervalStatsFile = fileName;
+    intervalCycles = cycles;
+}
+
+void CacheSimulator::setReplacementPolicy(ReplacementPolicy policy) {
+    if (restored || globalCycle != 0 || retiredInstructions != 0) {
+        throw std::logic_error("the replacement policy can only be changed before the simulator runs");
+    }
+    for (int i = 0; i < numCores; i++) {
+        cores[i].cache = Cache(i, setIndexBits, associativity, blockBits, dataCheck, policy);
+    }
+    if (l2) {
+        l2.reset(new SharedCache(l2->config, blockBits, numCores, policy));
+    }
+    replacementPolicy = policy;
+    LOG_INFO(std::string("Replacement policy: ") + replacementPolicyName(policy));
+}
+
+void CacheSimulator::setSharedCache(const SharedCacheConfig& config) {
+    if (restored || globalCycle != 0 || retiredInstructions != 0) {
+        throw std::logic_error("the L2 can only be added before the simulator runs");
+    }
+    l2.reset(new SharedCache(config, blockBits, numCores, replacementPolicy));
+    LOG_INFO("Shared L2: " + config.describe());
+}
+
+void CacheSimulator::setSplitBus(const SplitBusConfig& config) {
+    if (restored || globalCycle != 0 || retiredInstructions != 0) {
+        throw std::logic_error("the bus can only be changed before the simulator runs");
+    }
+    splitBus.reset(new SplitBus(config, blockSize));
+    LOG_INFO("Split-transaction bus: " + splitBus->config.describe());
+}
+
+void CacheSimulator::setEventLog(const std::string& fileName) {
+    if (fileName.empty()) {
+        throw std::invalid_argument("the event log needs a file name");
+    }
+    eventLogFile = fileName;
+}
+
+void CacheSimulator::setDataCheck() {
+    if (restored || globalCycle != 0 || retiredInstructions != 0) {
+        throw std::logic_error("the data check can only be enabled before the simulator runs");
+    }
+    dataCheck = true;
+    for (int i = 0; i < numCores; i++) {
+        cores[i].cache = Cache(i, setIndexBits, associativity, blockBits, true, replacementPolicy);
+    }
+}
+
+// A line payload holds the version of its block in its first bytes (all of them below 8-byte blocks)
+uint64_t CacheSimulator::lineVersion(int coreId, int slot) {
+    uint64_t version = 0;
+    memcpy(&version, cores[coreId].cache.lineData(slot), std::min<size_t>(sizeof(version), blockSize));
+    return version;
+}
+
+void CacheSimulator::setLineVersion(int coreId, int slot, uint64_t version) {
+    memcpy(cores[coreId].cache.lineData(slot), &version, std::min<size_t>(sizeof(version), blockSize));
+}
+
+// A read must see the last write to its block, whichever core made it
+void CacheSimulator::checkRead(int coreId, uint64_t address) {
+    uint64_t block = address >> blockBits;
+    std::unordered_map<uint64_t, uint64_t>::const_iterator last = latestVersion.find(block);
+    uint64_t expected = (last == latestVersion.end()) ? 0 : last->second;
+    uint64_t seen = lineVersion(coreId, cores[coreId].cache.findLine(address));
+    if (blockSize < (int)sizeof(seen)) {
+        expected &= ((uint64_t)1 << (8 * blockSize)) - 1;
+    }
+    if (seen != expected) {
+        throw std::logic_error("stale read: core " + std::to_string(coreId) + " read version " +
+                               std::to_string(seen) + " of block " + toHex(address & ~(uint64_t)(blockSize - 1)) +
+                               " in cycle " + std::to_string(globalCycle) + ", last written as version " +
+                               std::to_string(expected));
+    }
+    checkedReads++;
+}
+
+void CacheSimulator::recordWrite(int coreId, uint64_t address) {
+    uint64_t version = ++lastVersion;
+    latestVersion[address >> blockBits] = version;
+    setLineVersion(coreId, cores[coreId].cache.findLine(address), version);
+}
+
+void CacheSimulator::logEvent(long long cycle, int coreId, EventLogType type, uint64_t address, MemoryOperation op,
+                              CacheLineState oldState, CacheLineState newState, BusTransaction transaction) {
+    EventLogRecord record;
+    record.cycle = cycle;
+    record.address = address;
+    record.core = (uint32_t)coreId;
+    record.type = (uint8_t)type;
+    record.op = (uint8_t)op;
+    record.oldState = (uint8_t)oldState;
+    record.newState = (uint8_t)newState;
+    record.transaction = (uint8_t)transaction;
+    memset(record.reserved, 0, sizeof(record.reserved));
+    eventLog->append(record);
+}
+
+// Records every interval boundary up to cycle, before anything happens in cycle. The engines
+// call it only when cycle reaches nextIntervalCycle, so it costs one comparison per step.
+void CacheSimulator::recordIntervals(long long cycle) {
+    while (nextIntervalCycle <= cycle) {
+        snapshotInterval(nextIntervalCycle);
+        nextIntervalCycle = (nextIntervalCycle > LLONG_MAX - intervalCycles) ? LLONG_MAX : nextIntervalCycle + intervalCycles;
+    }
+}
+
+// Counters at the start of cycle. Stalls are credited to idletime and bus occupancy to
+// busBusyCycles when they begin, so the part that lies at or after cycle is taken off again;
+// a core parked on the bus (readyCycle behind cycle) has been idle since readyCycle.
+void CacheSimulator::snapshotInterval(long long cycle) {
+    std::vector<int64_t> &values = intervalValues;
+    values[INTERVAL_BUS_BUSY_CYCLES] = busBusyCycles - (splitBus ? splitBus->dataBusyAfter(cycle)
+                                                                  : std::max(0LL, busNextFree - cycle));
+    values[INTERVAL_BUS_TRANSACTIONS] = totalBusTransactions;
+    values[INTERVAL_BUS_TRAFFIC] = totalBusTraffic;
+    for (int i = 0; i < numCores; i++) {
+        const CoreState &core = cores[i];
+        int64_t* v = &values[NUM_INTERVAL_BUS_FIELDS + (size_t)i * NUM_INTERVAL_CORE_FIELDS];
+        v[INTERVAL_HITS] = core.hitCount;
+        v[INTERVAL_MISSES] = core.missCount;
+        v[INTERVAL_IDLE_CYCLES] = core.idletime;
+        if (!core.finished && (core.readyCycle > cycle || core.waitingForBus)) {
+            v[INTERVAL_IDLE_CYCLES] += cycle - core.readyCycle;
+        }
+        v[INTERVAL_INVALIDATIONS] = core.busInvalidations;
+    }
+    intervalStats->record(cycle, values.data());
+}
+
+void CacheSimulator::setCheckpoint(const std::string& fileName, long long atRetired, long long atCycle) {
+    if (fileName.empty() || atRetired < 0 || atCycle < 0) {
+        throw std::invalid_argument("a checkpoint needs a file name and a non-negative reference count or cycle");
+    }
+    checkpointFile = fileName;
+    checkpointAtRetired = atRetired;
+    checkpointAtCycle = atCycle;
+}
+
+// Credits cores parked on the bus with their idle time up to its release, the state the cycle
+// loop keeps them in, so either serial engine can resume them
+void CacheSimulator::settleBusWaiters() {
+    for (CoreState &core : cores) {
+        if (!core.finished && core.waitingForBus && core.readyCycle < busNextFree) {
+            PROFILE_STALL(core.profile, STALL_BUS_BUSY, busNextFree - core.readyCycle);
+            core.idletime += busNextFree - core.readyCycle;
+            core.readyCycle = busNextFree;
+        }
+    }
+}
+
+//
+// Runs the serial engine up to the checkpoint and writes it. A checkpoint by reference count is
+// taken at the end of the cycle in which the count is reached, so every checkpoint lies on a
+// cycle boundary and resuming gives exactly the results of an uninterrupted run.
+//
+void CacheSimulator::runUntilCheckpoint() {
+    if (parallelThreads > 0 || sampling.enabled()) {
+        throw std::invalid_argument("checkpoints are taken by the serial engines without sampling");
+    }
+    stopAtRetired = checkpointAtRetired;
+    stopAtCycle = checkpointAtCycle;
+    if (debugMode) {
+        runCycleLoop(); // returns at the end of a cycle
+    } else {
+        runEventLoop();
+        if (retiredInstructions >= stopAtRetired) {
+            stopAtRetired = LLONG_MAX;
+            stopAtCycle = globalCycle;
+            runEventLoop(); // the rest of the cycle
+        } else if (std::any_of(cores.begin(), cores.end(), [](const CoreState &cs){ return !cs.finished; })) {
+            globalCycle = checkpointAtCycle; // stopped at the end of that cycle, as the cycle loop does
+        }
+    }
+    stopAtRetired = LLONG_MAX;
+    stopAtCycle = LLONG_MAX;
+    settleBusWaiters();
+    saveCheckpoint(checkpointFile);
+}
+
+void CacheSimulator::saveCheckpoint(const std::string& fileName) const {
+    std::ofstream out(fileName, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("cannot create checkpoint: " + fileName);
+    }
+    CheckpointHeader header = CheckpointHeader();
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.numCores = (uint32_t)numCores;
+    header.setIndexBits = (uint32_t)setIndexBits;
+    header.associativity = (uint32_t)associativity;
+    header.blockBits = (uint32_t)blockBits;
+    header.replacement = (uint32_t)replacementPolicy;
+    header.cacheBytes = cores[0].cache.arenaBytes();
+    if (l2) {
+        header.l2Bytes = l2->cache.arenaBytes();
+        header.l2SizeBytes = l2->config.sizeBytes;
+        header.l2Ways = (uint32_t)l2->config.ways;
+        header.l2Latency = (uint32_t)l2->config.latency;
+        header.l2Banks = (uint32_t)l2->config.banks;
+        header.l2Inclusion = (uint32_t)l2->config.inclusion;
+    }
+    if (splitBus) {
+        header.splitBus = 1;
+        header.splitAddressCycles = (uint32_t)splitBus->config.addressCycles;
+        header.splitDataCycles = (uint32_t)splitBus->config.dataCycles;
+        header.splitOutstanding = (uint32_t)splitBus->config.maxOutstanding;
+    }
+    header.globalCycle = globalCycle;
+    header.busNextFree = busNextFree;
+    header.busOwner = busOwner;
+    header.busTransaction = busTransaction;
+    header.totalInvalidations = totalInvalidations;
+    header.totalBusTraffic = totalBusTraffic;
+    header.totalBusTransactions = totalBusTransactions;
+    header.retiredInstructions = retiredInstructions;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const CoreState &core : cores) {
+        CheckpointCore entry = CheckpointCore();
+        entry.tracePosition = core.chunkBase + core.chunkPos;
+        entry.chunkPos = core.chunkPos;
+        entry.seekable = core.trace->chunkStart(entry.chunkStart) ? 1 : 0;
+        entry.finished = core.finished;
+        entry.pendingComplete = core.pendingComplete;
+        entry.waitingForBus = core.waitingForBus;
+        entry.readyCycle = core.readyCycle;
+        entry.busRequestCycle = core.busRequestCycle;
+        entry.useClock = core.cache.lruClock();
+        entry.extime = core.extime;
+        entry.idletime = core.idletime;
+        entry.totalInstructions = core.totalInstructions;
+        entry.readCount = core.readCount;
+        entry.writeCount = core.writeCount;
+        entry.missCount = core.missCount;
+        entry.hitCount = core.hitCount;
+        entry.evictionCount = core.evictionCount;
+        entry.writebackCount = core.writebackCount;
+        entry.busInvalidations = core.busInvalidations;
+        entry.dataTraffic = core.dataTraffic;
+        entry.fastForwardInstructions = core.fastForward.instructions;
+        entry.fastForwardReads = core.fastForward.reads;
+        entry.fastForwardWrites = core.fastForward.writes;
+        entry.fastForwardMisses = core.fastForward.misses;
+        entry.fastForwardEvictions = core.fastForward.evictions;
+        entry.fastForwardWritebacks = core.fastForward.writebacks;
+        entry.fastForwardInvalidations = core.fastForward.invalidations;
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    }
+    for (const CoreState &core : cores) {
+        out.write(reinterpret_cast<const char*>(core.cache.image()), core.cache.arenaBytes());
+    }
+    if (l2) {
+        const SharedCacheStats &stats = l2->stats;
+        CheckpointSharedCache entry = CheckpointSharedCache();
+        entry.useClock = l2->cache.lruClock();
+        entry.hits = stats.hits;
+        entry.misses = stats.misses;
+        entry.writes = stats.writes;
+        entry.evictions = stats.evictions;
+        entry.memoryWritebacks = stats.memoryWritebacks;
+        entry.backInvalidations = stats.backInvalidations;
+        entry.bankConflictCycles = stats.bankConflictCycles;
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        out.write(reinterpret_cast<const char*>(l2->cache.image()), l2->cache.arenaBytes());
+        const std::vector<long long> &banks = l2->bankTimes();
+        for (long long bankFree : banks) {
+            int64_t value = bankFree;
+            out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+    }
+    if (splitBus) {
+        const SplitBusStats &stats = splitBus->stats;
+        const std::vector<SplitBus::Transfer> &inFlight = splitBus->inFlight();
+        CheckpointSplitBus entry = CheckpointSplitBus();
+        entry.addressFree = splitBus->addressFree();
+        entry.dataFree = splitBus->dataFree();
+        entry.inFlight = (int64_t)inFlight.size();
+        entry.transactions = stats.transactions;
+        entry.addressBusyCycles = stats.addressBusyCycles;
+        entry.dataBusyCycles = stats.dataBusyCycles;
+        entry.peakOutstanding = stats.peakOutstanding;
+        entry.addressWaitCycles = stats.addressWaitCycles;
+        entry.dataWaitCycles = stats.dataWaitCycles;
+        entry.dataTransactions = stats.dataTransactions;
+        std::copy(stats.addressWait, stats.addressWait + SPLIT_BUS_DELAY_BINS, entry.addressWait);
+        std::copy(stats.dataWait, stats.dataWait + SPLIT_BUS_DELAY_BINS, entry.dataWait);
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        for (const SplitBus::Transfer &transfer : inFlight) {
+            int64_t values[2] = { transfer.first, transfer.second };
+            out.write(reinterpret_cast<const char*>(values), sizeof(values));
+        }
+    }
+    if (!out) {
+        throw std::runtime_error("error writing checkpoint: " + fileName);
+    }
+}
+
+// Moves a freshly opened trace to a checkpointed position: a seek when the source supports one
+// for the stored position, otherwise by reading and dropping the records before it
+static void restoreTracePosition(CoreState &core, const CheckpointCore &entry) {
+    if (entry.finished) {
+        core.chunkLen = 0;
+        core.chunkPos = 0;
+        core.finished = true;
+        return;
+    }
+    if (entry.seekable && core.trace->seek(entry.chunkStart)) {
+        core.chunkLen = core.trace->nextChunk(core.chunk);
+        core.chunkBase = entry.tracePosition - entry.chunkPos;
+        core.chunkPos = (size_t)entry.chunkPos;
+    } else {
+        while (core.chunkLen > 0 && core.chunkBase + core.chunkLen <= entry.tracePosition) {
+            core.chunkBase += core.chunkLen;
+            core.chunkLen = core.trace->nextChunk(core.chunk);
+        }
+        core.chunkPos = (size_t)(entry.tracePosition - core.chunkBase);
+    }
+    if (core.chunkPos >= core.chunkLen) {
+        throw std::runtime_error("trace is shorter than the checkpoint position");
+    }
+    core.finished = false;
+}
+
+void CacheSimulator::restoreCheckpoint(const std::string& fileName) {
+    if (restored || globalCycle != 0 || retiredInstructions != 0) {
+        throw std::logic_error("a checkpoint can only be restored into a simulator that has not run");
+    }
+    MappedFile file(fileName);
+    const CheckpointHeader* header = reinterpret_cast<const CheckpointHeader*>(file.data());
+    if (file.size() < sizeof(CheckpointHeader) ||
+        memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0) {
+        throw std::runtime_error("not a simulator checkpoint: " + fileName);
+    }
+    if (header->version != CHECKPOINT_VERSION) {
+        throw std::runtime_error("unsupported checkpoint version " + std::to_string(header->version) +
+                                 " in " + fileName);
+    }
+    if (header->replacement != (uint32_t)replacementPolicy) {
+        throw std::runtime_error("checkpoint " + fileName + " was taken with " +
+                                 replacementPolicyName((ReplacementPolicy)header->replacement) + " replacement");
+    }
+    if ((int)header->numCores != numCores || (int)header->setIndexBits != setIndexBits ||
+        (int)header->associativity != associativity || (int)header->blockBits != blockBits ||
+        header->cacheBytes != cores[0].cache.arenaBytes()) {
+        throw std::runtime_error("checkpoint " + fileName + " was taken with a different geometry (" +
+                                 std::to_string(header->numCores) + " cores, s=" +
+                                 std::to_string(header->setIndexBits) + ", E=" +
+                                 std::to_string(header->associativity) + ", b=" +
+                                 std::to_string(header->blockBits) + ")");
+    }
+    bool sameL2 = l2 ? (header->l2Bytes == l2->cache.arenaBytes() && header->l2SizeBytes == l2->config.sizeBytes &&
+                        (int)header->l2Ways == l2->config.ways && (int)header->l2Latency == l2->config.latency &&
+                        (int)header->l2Banks == l2->config.banks &&
+                        header->l2Inclusion == (uint32_t)l2->config.inclusion)
+                     : header->l2Bytes == 0;
+    if (!sameL2) {
+        throw std::runtime_error("checkpoint " + fileName + " was taken with a different L2 configuration");
+    }
+    bool sameBus = splitBus ? (header->splitBus != 0 &&
+                               (int)header->splitAddressCycles == splitBus->config.addressCycles &&
+                               (int)header->splitDataCycles == splitBus->config.dataCycles &&
+                               (int)header->splitOutstanding == splitBus->config.maxOutstanding)
+                            : header->splitBus == 0;
+    if (!sameBus) {
+        throw std::runtime_error("checkpoint " + fileName + " was taken with a different bus configuration");
+    }
+    size_t coreBytes = numCores * sizeof(CheckpointCore);
+    size_t l2SectionBytes = l2 ? sizeof(CheckpointSharedCache) + header->l2Bytes + l2->config.banks * sizeof(int64_t) : 0;
+    size_t busOffset = sizeof(CheckpointHeader) + coreBytes + numCores * header->cacheBytes + l2SectionBytes;
+    size_t busSectionBytes = 0;
+    const CheckpointSplitBus* busEntry = nullptr;
+    if (splitBus && file.size() >= busOffset + sizeof(CheckpointSplitBus)) {
+        busEntry = reinterpret_cast<const CheckpointSplitBus*>(file.data() + busOffset);
+        if (busEntry->inFlight < 0 || busEntry->inFlight > splitBus->config.maxOutstanding) {
+            throw std::runtime_error("corrupt checkpoint: " + fileName);
+        }
+        busSectionBytes = sizeof(CheckpointSplitBus) + busEntry->inFlight * 2 * sizeof(int64_t);
+    } else if (splitBus) {
+        busSectionBytes = sizeof(CheckpointSplitBus);
+    }
+    if (file.size() != busOffset + busSectionBytes) {
+        throw std::runtime_error("truncated checkpoint: " + fileName);
+    }
+    const CheckpointCore* entries = reinterpret_cast<const CheckpointCore*>(file.data() + sizeof(CheckpointHeader));
+    const unsigned char* images = reinterpret_cast<const unsigned char*>(file.data()) +
+                                  sizeof(CheckpointHeader) + coreBytes;
+
+    globalCycle = header->globalCycle;
+    busNextFree = header->busNextFree;
+    busOwner = (int)header->busOwner;
+    busTransaction = (BusTransaction)header->busTransaction;
+    totalInvalidations = header->totalInvalidations;
+    totalBusTraffic = header->totalBusTraffic;
+    totalBusTransactions = header->totalBusTransactions;
+    retiredInstructions = header->retiredInstructions;
+
+    directory = SharerDirectory(numCores, numCores * ((size_t)associativity << setIndexBits));
+    for (int i = 0; i < numCores; i++) {
+        CoreState &core = cores[i];
+        const CheckpointCore &entry = entries[i];
+        restoreTracePosition(core, entry);
+        core.pendingComplete = entry.pendingComplete != 0;
+        core.waitingForBus = entry.waitingForBus != 0;
+        core.readyCycle = entry.readyCycle;
+        core.busRequestCycle = entry.busRequestCycle;
+        core.extime = entry.extime;
+        core.idletime = entry.idletime;
+        core.totalInstructions = entry.totalInstructions;
+        core.readCount = entry.readCount;
+        core.writeCount = entry.writeCount;
+        core.missCount = entry.missCount;
+        core.hitCount = entry.hitCount;
+        core.evictionCount = entry.evictionCount;
+        core.writebackCount = entry.writebackCount;
+        core.busInvalidations = entry.busInvalidations;
+        core.dataTraffic = entry.dataTraffic;
+        core.fastForward.instructions = entry.fastForwardInstructions;
+        core.fastForward.reads = entry.fastForwardReads;
+        core.fastForward.writes = entry.fastForwardWrites;
+        core.fastForward.misses = entry.fastForwardMisses;
+        core.fastForward.evictions = entry.fastForwardEvictions;
+        core.fastForward.writebacks = entry.fastForwardWritebacks;
+        core.fastForward.invalidations = entry.fastForwardInvalidations;
+        readSampledCounters(core, core.sampledAtStart);
+
+        core.cache.restoreImage(images + i * header->cacheBytes, entry.useClock);
+        for (int slot = 0; slot < numSets * associativity; slot++) {
+            CacheLineState state = core.cache.getState(slot);
+            if (state != INVALID) {
+                directory.setState(core.cache.getBlock(slot), i, state);
+            }
+        }
+    }
+    if (l2) {
+        const unsigned char* section = images + numCores * header->cacheBytes;
+        const CheckpointSharedCache* entry = reinterpret_cast<const CheckpointSharedCache*>(section);
+        SharedCacheStats &stats = l2->stats;
+        stats.hits = entry->hits;
+        stats.misses = entry->misses;
+        stats.writes = entry->writes;
+        stats.evictions = entry->evictions;
+        stats.memoryWritebacks = entry->memoryWritebacks;
+        stats.backInvalidations = entry->backInvalidations;
+        stats.bankConflictCycles = entry->bankConflictCycles;
+        section += sizeof(CheckpointSharedCache);
+        l2->cache.restoreImage(section, entry->useClock);
+        section += header->l2Bytes;
+        std::vector<long long> &banks = l2->bankTimes();
+        for (size_t i = 0; i < banks.size(); i++) {
+            int64_t value;
+            memcpy(&value, section + i * sizeof(value), sizeof(value));
+            banks[i] = value;
+        }
+    }
+    if (splitBus) {
+        SplitBusStats &stats = splitBus->stats;
+        stats.transactions = busEntry->transactions;
+        stats.addressBusyCycles = busEntry->addressBusyCycles;
+        stats.dataBusyCycles = busEntry->dataBusyCycles;
+        stats.peakOutstanding = busEntry->peakOutstanding;
+        stats.addressWaitCycles = busEntry->addressWaitCycles;
+        stats.dataWaitCycles = busEntry->dataWaitCycles;
+        stats.dataTransactions = busEntry->dataTransactions;
+        std::copy(busEntry->addressWait, busEntry->addressWait + SPLIT_BUS_DELAY_BINS, stats.addressWait);
+        std::copy(busEntry->dataWait, busEntry->dataWait + SPLIT_BUS_DELAY_BINS, stats.dataWait);
+        const unsigned char* pairs = reinterpret_cast<const unsigned char*>(busEntry + 1);
+        std::vector<SplitBus::Transfer> inFlight((size_t)busEntry->inFlight);
+        for (size_t i = 0; i < inFlight.size(); i++) {
+            int64_t values[2];
+            memcpy(values, pairs + i * sizeof(values), sizeof(values));
+            inFlight[i] = SplitBus::Transfer(values[0], values[1]);
+        }
+        splitBus->restore(busEntry->addressFree, busEntry->dataFree, inFlight);
+    }
+    restored = true;
+    LOG_INFO("Restored checkpoint " + fileName + " at cycle " + std::to_string(globalCycle));
+}
+
+void CacheSimulator::simulate() {
+#ifdef L1SIM_PROFILE
+    uint64_t startTicks = profileTicks();
+    auto startTime = std::chrono::steady_clock::now();
+#endif
+    if (parallelThreads > 0 && restored) {
+        throw std::invalid_argument("parallel mode cannot resume from a checkpoint");
+    }
+    if (dataCheck && (parallelThreads > 0 || restored || !checkpointFile.empty())) {
+        throw std::invalid_argument("the data check runs on the serial engines without checkpoints");
+    }
+    if (l2 && sampling.enabled()) {
+        throw std::invalid_argument("the shared L2 cannot be combined with sampling");
+    }
+    if (fastForwardRefs > 0) {
+        if (restored) {
+            throw std::invalid_argument("fast-forward cannot follow a restored checkpoint");
+        }
+        runFastForward();
+    }
+    if (parallelThreads > 0 && logLevel > LOG_LEVEL_OFF) {
+        throw std::invalid_argument("parallel mode cannot be combined with the text log");
+    }
+    if (!eventLogFile.empty()) {
+        if (parallelThreads > 0 || sampling.enabled()) {
+            throw std::invalid_argument("the event log is recorded by the serial engines without sampling");
+        }
+        // Fast-forwarded references are not logged
+        eventLog.reset(new EventLogWriter(eventLogFile, numCores, blockBits));
+    }
+    if (!intervalStatsFile.empty()) {
+        if (parallelThreads > 0 || sampling.intervalSampling()) {
+            throw std::invalid_argument("interval statistics are recorded by the serial engines without interval sampling");
+        }
+        // The first interval starts with the next cycle to simulate and ends on a multiple of the
+        // interval; the final one ends with the last cycle
+        intervalStats.reset(new IntervalStatsWriter(intervalStatsFile, numCores, intervalCycles));
+        intervalValues.assign(intervalStats->valuesPerSnapshot(), 0);
+        snapshotInterval(globalCycle + 1);
+        nextIntervalCycle = (globalCycle / intervalCycles + 1) * intervalCycles + 1;
+    }
+    if (!checkpointFile.empty()) {
+        runUntilCheckpoint();
+    }
+    if (parallelThreads > 0) {
+        runParallel();
+    } else if (sampling.intervalSampling()) {
+        runIntervalSampling();
+    } else if (debugMode) {
+        runCycleLoop();
+    } else {
+        runEventLoop();
+    }
+    if (intervalStats) {
+        snapshotInterval(globalCycle + 1);
+        intervalStats->finish();
+        intervalStats.reset();
+        nextIntervalCycle = LLONG_MAX;
+    }
+    if (eventLog) {
+        eventLog->close();
+        if (eventLog->stalls() > 0) {
+            LOG_INFO("Event log writer fell behind " + std::to_string(eventLog->stalls()) + " times");
+        }
+        eventLog.reset();
+    }
+#ifdef L1SIM_PROFILE
+    profileClock.ticks += profileTicks() - startTicks;
+    profileClock.nanoseconds +=
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+#endif
+}
+
+void CacheSimulator::runSimulation() {
+    simulate();
     printStatistics();
 }
 
+SimulationSummary CacheSimulator::summary() const {
+    SimulationSummary sum = SimulationSummary();
+    for (const CoreState &core : cores) {
+        sum.instructions += core.totalInstructions;
+        sum.reads += core.readCount;
+        sum.writes += core.writeCount;
+        sum.misses += core.missCount;
+        sum.evictions += core.evictionCount;
+        sum.writebacks += core.writebackCount;
+        sum.idleCycles += core.idletime;
+    }
+    sum.invalidations = totalInvalidations;
+    sum.busTransactions = totalBusTransactions;
+    sum.busTraffic = totalBusTraffic;
+    sum.cycles = globalCycle;
+    if (estimator) {
+        // Extrapolated totals in place of the raw counts of the sampled part
+        SimulationSummary est = sum;
+        est.misses = est.evictions = est.writebacks = est.idleCycles = 0;
+        for (int i = 0; i < numCores; i++) {
+            est.misses += llround(estimated(i, SAMPLED_MISSES).total);
+            est.evictions += llround(estimated(i, SAMPLED_EVICTIONS).total);
+            est.writebacks += llround(estimated(i, SAMPLED_WRITEBACKS).total);
+            est.idleCycles += llround(estimated(i, SAMPLED_IDLE_CYCLES).total);
+        }
+        est.busTransactions = llround(estimated(numCores, SAMPLED_BUS_TRANSACTIONS).total);
+        est.busTraffic = llround(estimated(numCores, SAMPLED_BUS_TRAFFIC).total);
+        // Invalidated lines are not sampled per unit; scale them by the sampled share of references
+        double sampledReferences = estimator->sum(numCores, SAMPLED_REFERENCES);
+        est.invalidations = (sampledReferences > 0)
+            ? llround(totalInvalidations * (double)retiredInstructions / sampledReferences) : 0;
+        est.cycles = sampling.setSampling() ? globalCycle * sampling.setRatio
+                     : llround(estimated(numCores, SAMPLED_ELAPSED_CYCLES).total);
+        return est;
+    }
+    return sum;
+}
+
 //
 // Print simulation statistics according to the requested format
 //
+// Prints the non-empty bins of a split bus delay histogram, up to the last one in use
+static void printDelayHistogram(std::ostream& out, const char* name, const long long* bins) {
+    int last = SPLIT_BUS_DELAY_BINS - 1;
+    while (last > 0 && bins[last] == 0) last--;
+    out << name << " Histogram (cycles: count):";
+    for (int bin = 0; bin <= last; bin++) {
+        out << " " << SplitBus::delayBinName(bin) << ": " << bins[bin];
+    }
+    out << std::endl;
+}
+
+// Occupancy and queueing of the split-transaction bus. Utilization is over the longest core's
+// execution, idle cycles included.
+void CacheSimulator::printSplitBusStatistics(std::ostream& out) const {
+    const SplitBusStats &stats = splitBus->stats;
+    long long elapsed = 0;
+    for (const CoreState &core : cores) {
+        elapsed = std::max(elapsed, core.extime + core.idletime);
+    }
+    auto percent = [&](long long cycles) { return elapsed > 0 ? 100.0 * cycles / elapsed : 0.0; };
+    auto mean = [](long long cycles, long long count) { return count > 0 ? (double)cycles / count : 0.0; };
+    out << std::fixed << std::setprecision(2);
+    out << "Address Bus Utilization: " << percent(stats.addressBusyCycles) << "%" << std::endl;
+    out << "Data Bus Utilization: " << percent(stats.dataBusyCycles) << "%" << std::endl;
+    out << "Peak Outstanding Transactions: " << stats.peakOutstanding << std::endl;
+    out << "Mean Address Bus Queueing Delay: " << mean(stats.addressWaitCycles, stats.transactions) << std::endl;
+    out << "Mean Data Bus Queueing Delay: " << mean(stats.dataWaitCycles, stats.dataTransactions) << std::endl;
+    printDelayHistogram(out, "Address Bus Queueing Delay", stats.addressWait);
+    printDelayHistogram(out, "Data Bus Queueing Delay", stats.dataWait);
+}
+
 void CacheSimulator::printStatistics() {
     std::ofstream outFile;
     if (!outFileName.empty()) {
@@ -816,17 +1999,45 @@ void CacheSimulator::printStatistics() {
     out << "Cache Size (KB per core): " << std::fixed << std::setprecision(2) << cacheSize << std::endl;
     out << "MESI Protocol: Enabled" << std::endl;
     out << "Write Policy: Write-back, Write-allocate" << std::endl;
-    out << "Replacement Policy: LRU" << std::endl;
-    out << "Bus: Central snooping bus" << std::endl;
+    out << "Replacement Policy: " << replacementPolicyName(replacementPolicy) << std::endl;
+    if (splitBus) {
+        out << "Bus: Split-transaction snooping bus (" << splitBus->config.describe() << ")" << std::endl;
+    } else {
+        out << "Bus: Central snooping bus" << std::endl;
+    }
+    if (l2) {
+        out << "Shared L2: " << l2->config.describe() << std::endl;
+    }
+    if (estimator) {
+        out << "Sampling: " << sampling.describe() << " (estimates +/- 95% confidence interval)" << std::endl;
+    }
+    if (dataCheck) {
+        out << "Data Check: " << checkedReads << " reads saw the last write to their block" << std::endl;
+    }
     out << std::endl;
     
+    // A counter as printed: the raw count, or its sampled estimate with the interval half-width
+    auto stat = [&](int row, int sampledStat, long long raw) -> std::string {
+        if (!estimator) return std::to_string(raw);
+        SampleEstimate e = estimated(row, sampledStat);
+        if (std::isinf(e.halfWidth)) return std::to_string(llround(e.total)) + " +/- n/a";
+        return std::to_string(llround(e.total)) + " +/- " + std::to_string(llround(e.halfWidth));
+    };
+    
     // Core statistics
     for (int i = 0; i < numCores; i++) {
         const CoreState &core = cores[i];
         
         double missRate = 0.0;
+        double missRateHalfWidth = 0.0;
         if (core.readCount + core.writeCount > 0) {
-            missRate = 100.0 * (double)core.missCount / (double)(core.readCount + core.writeCount);
+            double accesses = (double)(core.readCount + core.writeCount);
+            missRate = 100.0 * (double)core.missCount / accesses;
+            if (estimator) {
+                SampleEstimate misses = estimated(i, SAMPLED_MISSES);
+                missRate = 100.0 * misses.total / accesses;
+                missRateHalfWidth = 100.0 * misses.halfWidth / accesses;
+            }
         }
         
         out << "Core " << i << " Statistics:" << std::endl;
@@ -834,20 +2045,91 @@ void CacheSimulator::printStatistics() {
         out << "Total Reads: " << core.readCount << std::endl;
         out << "Total Writes: " << core.writeCount << std::endl;
         out << "Total Execution Cycles: " << core.extime << std::endl;
-        out << "Idle Cycles: " << core.idletime << std::endl;
-        out << "Cache Misses: " << core.missCount << std::endl;
-        out << "Cache Miss Rate: " << std::fixed << std::setprecision(2) << missRate << "%" << std::endl;
-        out << "Cache Evictions: " << core.evictionCount << std::endl;
-        out << "Writebacks: " << core.writebackCount << std::endl;
-        out << "Bus Invalidations: " << core.busInvalidations << std::endl;
-        out << "Data Traffic (Bytes): " << core.dataTraffic << std::endl;
+        out << "Idle Cycles: " << stat(i, SAMPLED_IDLE_CYCLES, core.idletime) << std::endl;
+        out << "Cache Misses: " << stat(i, SAMPLED_MISSES, core.missCount) << std::endl;
+        out << "Cache Miss Rate: " << std::fixed << std::setprecision(2) << missRate << "%";
+        if (estimator) {
+            if (std::isinf(missRateHalfWidth)) out << " +/- n/a";
+            else out << " +/- " << missRateHalfWidth << "%";
+        }
+        out << std::endl;
+        out << "Cache Evictions: " << stat(i, SAMPLED_EVICTIONS, core.evictionCount) << std::endl;
+        out << "Writebacks: " << stat(i, SAMPLED_WRITEBACKS, core.writebackCount) << std::endl;
+        out << "Bus Invalidations: " << stat(i, SAMPLED_INVALIDATIONS, core.busInvalidations) << std::endl;
+        out << "Data Traffic (Bytes): " << stat(i, SAMPLED_TRAFFIC, core.dataTraffic) << std::endl;
         out << std::endl;
     }
     
     // Overall bus summary
     out << "Overall Bus Summary:" << std::endl;
-    out << "Total Bus Transactions: " << totalBusTransactions << std::endl;
-    out << "Total Bus Traffic (Bytes): " << totalBusTraffic << std::endl;
+    out << "Total Bus Transactions: " << stat(numCores, SAMPLED_BUS_TRANSACTIONS, totalBusTransactions) << std::endl;
+    out << "Total Bus Traffic (Bytes): " << stat(numCores, SAMPLED_BUS_TRAFFIC, totalBusTraffic) << std::endl;
+    if (splitBus) {
+        printSplitBusStatistics(out);
+    }
+
+    // Hit and miss counts per level when there is an L2
+    if (l2) {
+        long long l1Accesses = 0;
+        long long l1Misses = 0;
+        for (const CoreState &core : cores) {
+            l1Accesses += core.readCount + core.writeCount;
+            l1Misses += core.missCount;
+        }
+        const SharedCacheStats &l2Stats = l2->stats;
+        long long l2Fetches = l2Stats.hits + l2Stats.misses;
+        out << std::endl << "Cache Hierarchy Summary:" << std::endl;
+        out << "L1 Accesses: " << l1Accesses << std::endl;
+        out << "L1 Hits: " << l1Accesses - l1Misses << std::endl;
+        out << "L1 Misses: " << l1Misses << std::endl;
+        out << "L1 Miss Rate: " << std::fixed << std::setprecision(2)
+            << (l1Accesses > 0 ? 100.0 * l1Misses / l1Accesses : 0.0) << "%" << std::endl;
+        out << "L2 Fetches: " << l2Fetches << std::endl;
+        out << "L2 Hits: " << l2Stats.hits << std::endl;
+        out << "L2 Misses: " << l2Stats.misses << std::endl;
+        out << "L2 Miss Rate: " << std::fixed << std::setprecision(2)
+            << (l2Fetches > 0 ? 100.0 * l2Stats.misses / l2Fetches : 0.0) << "%" << std::endl;
+        out << "L2 Writes (L1 Write Backs): " << l2Stats.writes << std::endl;
+        out << "L2 Evictions: " << l2Stats.evictions << std::endl;
+        out << "L2 Writebacks to Memory: " << l2Stats.memoryWritebacks << std::endl;
+        out << "L2 Back-Invalidations: " << l2Stats.backInvalidations << std::endl;
+        out << "L2 Bank Conflict Cycles: " << l2Stats.bankConflictCycles << std::endl;
+    }
+    
+    // Functional fast-forward before the detailed statistics above
+    if (std::any_of(cores.begin(), cores.end(), [](const CoreState &cs){ return cs.fastForward.instructions > 0; })) {
+        out << std::endl << "Fast-Forward Statistics (functional, not timed):" << std::endl;
+        for (int i = 0; i < numCores; i++) {
+            const FastForwardStats &ff = cores[i].fastForward;
+            double missRate = (ff.instructions > 0) ? 100.0 * ff.misses / ff.instructions : 0.0;
+            out << "Core " << i << " Instructions: " << ff.instructions << ", Reads: " << ff.reads
+                << ", Writes: " << ff.writes << ", Misses: " << ff.misses << " (" << std::fixed
+                << std::setprecision(2) << missRate << "%), Evictions: " << ff.evictions
+                << ", Writebacks: " << ff.writebacks << ", Bus Invalidations: " << ff.invalidations << std::endl;
+        }
+    }
+    
+    // Ring stalls when the traces were read ahead on background threads
+    TraceStallCounters stalls;
+    if (numCores > 0 && cores[0].trace->stallCounters(stalls)) {
+        out << std::endl << "Trace Prefetch:" << std::endl;
+        for (int i = 0; i < numCores; i++) {
+            cores[i].trace->stallCounters(stalls);
+            out << "Core " << i << " Ring Full Stalls: " << stalls.ringFull
+                << ", Ring Empty Stalls: " << stalls.ringEmpty << std::endl;
+        }
+    }
+
+#ifdef L1SIM_PROFILE
+    ProfileCounters total = profile;
+    long long idleCycles = 0;
+    for (const CoreState &core : cores) {
+        total.add(core.profile);
+        idleCycles += core.idletime;
+    }
+    out << std::endl;
+    printProfile(out, total, profileClock, idleCycles);
+#endif
     
     if (outFile.is_open()) {
         outFile.close();
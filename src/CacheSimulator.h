@@ -5,6 +5,21 @@
 #include <vector>
 #include <fstream>
 #include <utility>
+#include <memory>
+#include <unordered_map>
+#include "utils.h"
+#include "SharerDirectory.h"
+#include "Sampling.h"
+#include "Profile.h"
+#include "EventLog.h"
+#include "Replacement.h"
+
+class TraceSource;
+class IntervalStatsWriter;
+class SharedCache;
+struct SharedCacheConfig;
+class SplitBus;
+struct SplitBusConfig;
 
 
 enum BusTransaction {
@@ -18,33 +33,182 @@ enum BusTransaction {
     None
 };
 
+// Totals over all cores, used to tabulate many runs side by side
+struct SimulationSummary {
+    long long instructions;
+    long long reads;
+    long long writes;
+    long long misses;
+    long long evictions;
+    long long writebacks;
+    long long invalidations;
+    long long busTransactions;
+    long long busTraffic;  // in bytes
+    long long cycles;      // cycle in which the last core finished
+    long long idleCycles;
+};
+
 class CacheSimulator {
 private:
     std::vector<struct CoreState> cores; // now holds per-core simulation state
     std::string outFileName;
     int numCores;
-    int totalInvalidations;
-    int totalBusTraffic; // in bytes
-    int totalBusTransactions;
-    int globalCycle; //what is this ?
-    bool busFree;
-    unsigned int busNextFree; //bus is next free at this time
-    BusTransaction busTransaction;
-    int busOwner;
+    long long totalInvalidations;
+    long long totalBusTraffic; // in bytes
+    long long totalBusTransactions;
+    long long globalCycle;   // cycle currently being simulated
+    long long busNextFree;   // first cycle in which the bus is free again
+    BusTransaction busTransaction; // last transaction placed on the bus
+    int busOwner;      // core that placed it
     int blockSize;     // Derived from block bits b: blockSize = 2^b
-    bool debugMode;    // Flag for debug output
+    bool debugMode;    // Flag for debug output: cycle-by-cycle engine
+    int logLevel;      // LogLevel of the text log (Log.h), TRACE with debugMode
     
     // Cache configuration
     int setIndexBits;  // s
     int associativity; // E
     int blockBits;     // b
     int numSets;       // 2^s
+    ReplacementPolicy replacementPolicy; // of every core's cache (setReplacementPolicy)
+
+    SharerDirectory directory;           // holders of every cached block, kept by setLineState
+    std::vector<uint64_t> sharerScratch; // sharer bits of the block being invalidated
+
+    // Parallel mode (setParallel): worker threads and the cycle quantum between barriers
+    int parallelThreads; // 0 = serial engines
+    int quantumCycles;
+
+    // Sampled simulation (setSampling)
+    SamplingConfig sampling;
+    std::unique_ptr<SampleEstimator> estimator; // null unless sampling
+    int windowUnit;                 // estimator unit of the current detailed window, -1 while warming
+    long long retiredInstructions;  // over all cores
+    long long stopAtRetired;        // the serial engines return once retiredInstructions reaches it
+    long long stopAtCycle;          // ... or before simulating any cycle past this one
+
+    // Checkpointing (setCheckpoint, restoreCheckpoint)
+    std::string checkpointFile;     // empty = no checkpoint
+    long long checkpointAtRetired;
+    long long checkpointAtCycle;
+    bool restored;
+
+    long long fastForwardRefs;      // per core, run functionally before the detailed engines (setFastForward)
+
+    // Interval time series (setIntervalStats)
+    std::unique_ptr<IntervalStatsWriter> intervalStats;
+    std::string intervalStatsFile;
+    int intervalCycles;             // 0 = off
+    long long nextIntervalCycle;    // first cycle of the next interval, LLONG_MAX when not recording
+    long long busBusyCycles;        // cycles the bus (the data bus when split) is occupied, counted when a transaction starts
+    std::vector<int64_t> intervalValues; // snapshot being assembled
+
+    std::unique_ptr<SharedCache> l2;     // shared L2 behind the L1s (setSharedCache), null = memory only
+    std::unique_ptr<SplitBus> splitBus;  // split-transaction bus (setSplitBus), null = atomic bus
+
+    // Binary event log (setEventLog)
+    std::unique_ptr<EventLogWriter> eventLog; // null unless logging
+    std::string eventLogFile;
+
+    // Data check (setDataCheck): every write gives its block a new version, which the writer's
+    // line payload holds and which fills and write backs carry between the caches and below
+    bool dataCheck;
+    uint64_t lastVersion;           // versions handed out
+    long long checkedReads;
+    std::unordered_map<uint64_t, uint64_t> latestVersion; // block -> version of its last write
+    std::unordered_map<uint64_t, uint64_t> versionBelow;  // block -> version the L2 or memory holds
+
+    // Hot-path profile (L1SIM_PROFILE builds only): engine-wide regions here, the rest per core
+    ProfileCounters profile;
+    ProfileClock profileClock;      // duration of simulate()
+
+    void setLineState(int coreId, int slot, CacheLineState state);
+    int fillLine(int coreId, uint64_t address, CacheLineState state, long long cycle);
+    int readBelow(int coreId, long long cycle, uint64_t address, bool &dirty);
+    int writeBelow(int coreId, long long cycle, uint64_t address, bool dirty);
+    void allocateBelow(int coreId, uint64_t address, CacheLineState state);
+    void printSplitBusStatistics(std::ostream& out) const;
+    void advanceTrace(int coreId);
+    void retireInstruction(int coreId, long long cycle);
+    int grantSplitBus(int coreId, long long cycle, int latencyCycles, int writebacks);
+    void startBusTransaction(int coreId, long long cycle, BusTransaction type, int coreCycles, int busCycles,
+                             int latencyCycles, int writebacks);
+    bool executeHit(int coreId, long long cycle, int &slot);
+    void issueBusRequest(int coreId, long long cycle, int slot);
+    void stepCore(int coreId, long long cycle);
+    void runEventLoop();
+    void runCycleLoop();
+    void runParallel();
+
+    int sampleUnitOf(uint64_t address) const;
+    bool skipUnsampled(int coreId);
+    void attributeRetirement(int coreId);
+    void noteRemoteWriteback(int ownerId, uint64_t address);
+    void functionalAccess(int coreId);
+    void runIntervalSampling();
+    SampleEstimate estimated(int row, int stat) const;
+
+    void logEvent(long long cycle, int coreId, EventLogType type, uint64_t address, MemoryOperation op,
+                  CacheLineState oldState, CacheLineState newState, BusTransaction transaction);
+
+    void recordIntervals(long long cycle);
+    void snapshotInterval(long long cycle);
+
+    void runFastForward();
+    void runUntilCheckpoint();
+    void settleBusWaiters();
+
+    uint64_t lineVersion(int coreId, int slot);
+    void setLineVersion(int coreId, int slot, uint64_t version);
+    void checkRead(int coreId, uint64_t address);
+    void recordWrite(int coreId, uint64_t address);
 
 public:
+    // numCores <= 0 takes one core per trace found for the prefix. level is the text log
+    // verbosity, a LogLevel, or -1 for TRACE with debug and OFF without; levels above the
+    // compiled-in L1SIM_LOG_LEVEL print nothing.
     CacheSimulator(const std::string& traceFilePrefix, int s, int E, int b, 
-                   const std::string& outFileName, bool debug = false);
+                   const std::string& outFileName, bool debug = false, int numCores = 0, int level = -1);
+    // One already opened trace source per core
+    CacheSimulator(std::vector<std::unique_ptr<TraceSource> > sources, int s, int E, int b,
+                   const std::string& outFileName, bool debug = false, int level = -1);
     ~CacheSimulator();
-    void runSimulation();
+    // Simulates groups of cores on numThreads worker threads that synchronize every quantum cycles.
+    // Bus requests are resolved in a deterministic order at each barrier, so results do not depend
+    // on numThreads, but they approximate the serial engines more loosely as the quantum grows.
+    void setParallel(int numThreads, int quantum);
+    // Sampled simulation; printStatistics then reports estimates with 95% confidence intervals
+    void setSampling(const SamplingConfig& config);
+    // Runs the first refsPerCore references of every core through the caches and the coherence
+    // state only, with no timing; printStatistics reports their counts separately
+    void setFastForward(long long refsPerCore);
+    // Writes a checkpoint once atRetired references (over all cores) have retired, or at the end
+    // of cycle atCycle, whichever comes first, then carries on to the end of the traces
+    void setCheckpoint(const std::string& fileName, long long atRetired, long long atCycle);
+    // Complete simulator state as a file that restoreCheckpoint can resume from
+    void saveCheckpoint(const std::string& fileName) const;
+    // Resumes from a checkpoint taken with the same geometry and traces; call before simulating
+    void restoreCheckpoint(const std::string& fileName);
+    // Writes the counters gained in every intervalCycles cycles to fileName, as CSV or, for a
+    // .l1is name, in binary (see IntervalStats.h); serial engines only
+    void setIntervalStats(const std::string& fileName, int intervalCycles);
+    // Rebuilds the (still empty) caches with another replacement policy; call before simulating
+    // or restoring. Builds with a compile-time policy accept only that one.
+    void setReplacementPolicy(ReplacementPolicy policy);
+    // Puts a shared L2 between the L1s and memory; call before simulating or restoring
+    void setSharedCache(const SharedCacheConfig& config);
+    // Replaces the atomic bus with a split-transaction one; call before simulating or restoring
+    void setSplitBus(const SplitBusConfig& config);
+    // Writes every hit, miss, upgrade, snoop and eviction to fileName in binary (see EventLog.h)
+    // from a background thread; serial engines only
+    void setEventLog(const std::string& fileName);
+    // Gives the L1s block payloads that carry the version of each block's last write through
+    // every fill, transfer and write back, and checks each read against it; std::logic_error
+    // at the first stale read. Call before simulating; serial engines without checkpoints only.
+    void setDataCheck();
+    long long checkedReadCount() const { return checkedReads; }
+    void runSimulation();  // simulate() followed by printStatistics()
+    void simulate();
+    SimulationSummary summary() const;
     void printStatistics();
     void debugPrint(const std::string& message);
 };
@@ -0,0 +1,115 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "TraceReader.h"
+#include "SplitBus.h"
+#include <cstdint>
+
+//
+// Simulator checkpoint file (.l1ck), little endian, written by CacheSimulator::saveCheckpoint:
+//   CheckpointHeader
+//   CheckpointCore[numCores]
+//   numCores cache images of cacheBytes each (Cache::image)
+//   with a shared L2 (l2Bytes != 0): CheckpointSharedCache, its image of l2Bytes, and the
+//   next free cycle (int64_t) of each of its banks
+//   with a split-transaction bus (splitBus != 0): CheckpointSplitBus and splitInFlight pairs of
+//   int64_t, the completion cycle and data phase start of each transaction in flight
+// Every section is a fixed-size array of plain structs, so a restore maps the file and copies
+// the cache images straight into the caches. The sharer directory is not stored; it is rebuilt
+// from the cache contents.
+//
+const char CHECKPOINT_MAGIC[4] = { 'L', '1', 'C', 'K' };
+// 2: fast-forward statistics, 3: 64-bit tags and LRU stamps, 4: replacement policy, 5: shared L2,
+// 6: split-transaction bus
+const uint32_t CHECKPOINT_VERSION = 6;
+
+struct CheckpointHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numCores;
+    uint32_t setIndexBits;
+    uint32_t associativity;
+    uint32_t blockBits;
+    uint32_t replacement;      // ReplacementPolicy
+    uint32_t reserved;
+    uint64_t cacheBytes;       // size of each core's cache image
+    uint64_t l2Bytes;          // size of the L2 image, 0 without an L2
+    uint64_t l2SizeBytes;      // L2 configuration (SharedCacheConfig)
+    uint32_t l2Ways;
+    uint32_t l2Latency;
+    uint32_t l2Banks;
+    uint32_t l2Inclusion;
+    uint32_t splitBus;         // split-transaction bus configuration (SplitBusConfig), 0 = atomic bus
+    uint32_t splitAddressCycles;
+    uint32_t splitDataCycles;
+    uint32_t splitOutstanding;
+    int64_t globalCycle;
+    int64_t busNextFree;
+    int64_t busOwner;
+    int64_t busTransaction;    // BusTransaction
+    int64_t totalInvalidations;
+    int64_t totalBusTraffic;
+    int64_t totalBusTransactions;
+    int64_t retiredInstructions;
+};
+
+struct CheckpointCore {
+    // Trace: records consumed, and where the current chunk was decoded from when the
+    // source can seek (seekable != 0)
+    uint64_t tracePosition;
+    uint64_t chunkPos;
+    TracePosition chunkStart;
+    uint32_t seekable;
+    uint32_t finished;
+    uint32_t pendingComplete;
+    uint32_t waitingForBus;
+    int64_t readyCycle;
+    int64_t busRequestCycle;   // -1 unless waiting for the bus
+    uint64_t useClock;         // the cache's LRU clock or replacement generator state
+    int64_t extime;
+    int64_t idletime;
+    int64_t totalInstructions;
+    int64_t readCount;
+    int64_t writeCount;
+    int64_t missCount;
+    int64_t hitCount;
+    int64_t evictionCount;
+    int64_t writebackCount;
+    int64_t busInvalidations;
+    int64_t dataTraffic;
+    int64_t fastForwardInstructions;
+    int64_t fastForwardReads;
+    int64_t fastForwardWrites;
+    int64_t fastForwardMisses;
+    int64_t fastForwardEvictions;
+    int64_t fastForwardWritebacks;
+    int64_t fastForwardInvalidations;
+};
+
+struct CheckpointSharedCache {
+    uint64_t useClock;         // the L2's LRU clock or replacement generator state
+    int64_t hits;
+    int64_t misses;
+    int64_t writes;
+    int64_t evictions;
+    int64_t memoryWritebacks;
+    int64_t backInvalidations;
+    int64_t bankConflictCycles;
+};
+
+struct CheckpointSplitBus {
+    int64_t addressFree;
+    int64_t dataFree;
+    int64_t inFlight;          // number of pairs that follow
+    int64_t transactions;
+    int64_t addressBusyCycles;
+    int64_t dataBusyCycles;
+    int64_t peakOutstanding;
+    int64_t addressWaitCycles;
+    int64_t dataWaitCycles;
+    int64_t dataTransactions;
+    int64_t addressWait[SPLIT_BUS_DELAY_BINS];
+    int64_t dataWait[SPLIT_BUS_DELAY_BINS];
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,96 @@
+#include "EventLog.h"
+#include <stdexcept>
+#include <chrono>
+#include <cstring>
+using namespace std;
+
+static const size_t EVENT_RING_RECORDS = 1 << 16;
+static const size_t EVENT_BATCH_RECORDS = 4096; // committed to the writer at a time
+
+const char* eventTypeName(int type) {
+    static const char* const names[] = { "HIT", "MISS", "UPGRADE", "SNOOP", "EVICT" };
+    return (type >= 0 && type < (int)(sizeof(names) / sizeof(names[0]))) ? names[type] : "?";
+}
+
+// In BusTransaction order (CacheSimulator.h)
+const char* busTransactionName(int transaction) {
+    static const char* const names[] = {
+        "ReadWithIntentToModify", "WriteBackOnOtherReadMiss", "WriteBackOnEviction", "WriteBackOnOtherWriteMiss",
+        "ReadFromMem", "ReadCacheToCache", "BroadCastInvalidate", "None"
+    };
+    return (transaction >= 0 && transaction < (int)(sizeof(names) / sizeof(names[0]))) ? names[transaction] : "?";
+}
+
+EventLogWriter::EventLogWriter(const string& fileName, int numCores, int blockBits)
+    : fileName(fileName), ring(EVENT_RING_RECORDS), batch(nullptr), batchLen(0), batchUsed(0), ringFull(0),
+      closing(false), failed(false) {
+    out.open(fileName, ios::binary);
+    if (!out.is_open()) {
+        throw runtime_error("cannot create event log: " + fileName);
+    }
+    EventLogHeader header;
+    memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.version = EVENT_LOG_VERSION;
+    header.numCores = (uint32_t)numCores;
+    header.blockBits = (uint32_t)blockBits;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writer = thread(&EventLogWriter::writeLoop, this);
+}
+
+EventLogWriter::~EventLogWriter() {
+    if (writer.joinable()) {
+        try {
+            close();
+        } catch (const exception&) {
+            // already unwinding; the log is left truncated
+        }
+    }
+}
+
+// Commits the filled batch and claims the next span of the ring, waiting for the writer if full
+void EventLogWriter::nextBatch() {
+    ring.commit(batchUsed);
+    batchUsed = 0;
+    size_t n;
+    for (int spins = 0; (n = ring.writable(batch)) == 0; spins++) {
+        if (spins == 0) ringFull++; // counted once per stall
+        if (failed.load(memory_order_relaxed)) {
+            throw runtime_error("error writing event log: " + fileName);
+        }
+        if (spins > 100) this_thread::yield();
+    }
+    batchLen = min(n, EVENT_BATCH_RECORDS);
+}
+
+void EventLogWriter::writeLoop() {
+    while (true) {
+        const EventLogRecord* span;
+        size_t n = ring.readable(span);
+        if (n > 0) {
+            out.write(reinterpret_cast<const char*>(span), n * sizeof(EventLogRecord));
+            ring.release(n);
+            if (!out) {
+                failed.store(true, memory_order_relaxed);
+                return;
+            }
+            continue;
+        }
+        if (closing.load(memory_order_acquire)) {
+            // Everything committed before `closing` was set is readable now
+            if (ring.readable(span) == 0) return;
+            continue;
+        }
+        this_thread::sleep_for(chrono::microseconds(50));
+    }
+}
+
+void EventLogWriter::close() {
+    ring.commit(batchUsed);
+    batchUsed = batchLen = 0;
+    closing.store(true, memory_order_release);
+    writer.join();
+    out.close();
+    if (failed.load(memory_order_relaxed) || !out) {
+        throw runtime_error("error writing event log: " + fileName);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "SpscRing.h"
+#include <string>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+//
+// Binary event log (.l1ev), little endian, written by the simulator with --event-log:
+//   EventLogHeader
+//   EventLogRecord, one per event, in simulation order
+// Records are fixed size, so the log can be mapped and indexed directly. The eventlog tool
+// prints it as text.
+//
+const char EVENT_LOG_MAGIC[4] = { 'L', '1', 'E', 'V' };
+const uint32_t EVENT_LOG_VERSION = 2; // 2: 64-bit addresses
+
+struct EventLogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numCores;
+    uint32_t blockBits;
+};
+
+enum EventLogType {
+    EVENT_HIT,     // access served by the core's own cache
+    EVENT_MISS,    // access that placed a bus transaction
+    EVENT_UPGRADE, // write to an own SHARED copy: invalidation broadcast
+    EVENT_SNOOP,   // another core's copy changed state because of the access
+    EVENT_EVICT    // line evicted to make room (written back if it was MODIFIED)
+};
+
+struct EventLogRecord {
+    int64_t cycle;
+    uint64_t address;    // of the access, or the block of a snooped or evicted line
+    uint32_t core;       // whose line changed state
+    uint8_t type;        // EventLogType
+    uint8_t op;          // MemoryOperation of the access
+    uint8_t oldState;    // CacheLineState of the line before and after
+    uint8_t newState;
+    uint8_t transaction; // BusTransaction placed on the bus, None for hits, snoops and evictions
+    uint8_t reserved[7];
+};
+
+const char* eventTypeName(int type);
+const char* busTransactionName(int transaction);
+
+//
+// Writes the log on a background thread. The simulator fills batches of records straight into
+// a bounded single-producer/single-consumer ring and the writer thread copies committed spans to
+// the file, so the simulator never waits on I/O unless the ring fills up.
+//
+class EventLogWriter {
+private:
+    std::ofstream out;
+    std::string fileName;
+    SpscRing<EventLogRecord> ring;
+    EventLogRecord* batch;   // span of the ring being filled
+    size_t batchLen;
+    size_t batchUsed;
+    uint64_t ringFull;       // times the simulator had to wait for the writer
+    std::atomic<bool> closing;
+    std::atomic<bool> failed;
+    std::thread writer;
+
+    void writeLoop();
+    void nextBatch();
+
+public:
+    EventLogWriter(const std::string& fileName, int numCores, int blockBits);
+    ~EventLogWriter();
+    void append(const EventLogRecord& record) {
+        if (batchUsed == batchLen) nextBatch();
+        batch[batchUsed++] = record;
+    }
+    // Hands the last batch to the writer, waits for it to finish and closes the file
+    void close();
+    uint64_t stalls() const { return ringFull; }
+
+private:
+    EventLogWriter(const EventLogWriter&);
+    EventLogWriter& operator=(const EventLogWriter&);
+};
+
+#endif // EVENT_LOG_H
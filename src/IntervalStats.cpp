@@ -0,0 +1,91 @@
+#include "IntervalStats.h"
+#include <stdexcept>
+#include <cstring>
+using namespace std;
+
+static const size_t BUFFER_ROWS = 4096;
+
+static bool hasSuffix(const string& name, const string& suffix) {
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+IntervalStatsWriter::IntervalStatsWriter(const string& fileName, int numCores, int intervalCycles)
+    : fileName(fileName), binary(hasSuffix(fileName, INTERVAL_STATS_EXTENSION)),
+      valuesPerRow(NUM_INTERVAL_BUS_FIELDS + (size_t)numCores * NUM_INTERVAL_CORE_FIELDS),
+      previous(valuesPerRow), previousCycle(-1), rows(0), capacityRows(BUFFER_ROWS) {
+    out.open(fileName, binary ? ios::binary : ios::out);
+    if (!out.is_open()) {
+        throw runtime_error("cannot create interval statistics file: " + fileName);
+    }
+    buffer.resize(capacityRows * (2 + valuesPerRow));
+
+    if (binary) {
+        IntervalStatsHeader header;
+        memcpy(header.magic, INTERVAL_STATS_MAGIC, sizeof(header.magic));
+        header.version = INTERVAL_STATS_VERSION;
+        header.numCores = (uint32_t)numCores;
+        header.intervalCycles = (uint32_t)intervalCycles;
+        header.busFields = NUM_INTERVAL_BUS_FIELDS;
+        header.coreFields = NUM_INTERVAL_CORE_FIELDS;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return;
+    }
+    out << "start_cycle,end_cycle,bus_busy_cycles,bus_transactions,bus_traffic_bytes";
+    for (int i = 0; i < numCores; i++) {
+        out << ",core" << i << "_hits,core" << i << "_misses,core" << i << "_idle_cycles,core" << i
+            << "_invalidations";
+    }
+    out << "\n";
+}
+
+IntervalStatsWriter::~IntervalStatsWriter() {
+    if (out.is_open()) {
+        try {
+            finish();
+        } catch (const exception&) {
+            // already unwinding or shutting down; the file is left truncated
+        }
+    }
+}
+
+void IntervalStatsWriter::record(int64_t cycle, const int64_t* cumulative) {
+    if (previousCycle >= 0 && cycle > previousCycle) {
+        if (rows == capacityRows) {
+            flush();
+        }
+        int64_t* row = &buffer[rows * (2 + valuesPerRow)];
+        row[0] = previousCycle;
+        row[1] = cycle - 1;
+        for (size_t i = 0; i < valuesPerRow; i++) {
+            row[2 + i] = cumulative[i] - previous[i];
+        }
+        rows++;
+    }
+    memcpy(previous.data(), cumulative, valuesPerRow * sizeof(int64_t));
+    previousCycle = cycle;
+}
+
+void IntervalStatsWriter::flush() {
+    size_t rowLength = 2 + valuesPerRow;
+    if (binary) {
+        out.write(reinterpret_cast<const char*>(buffer.data()), rows * rowLength * sizeof(int64_t));
+    } else {
+        for (size_t r = 0; r < rows; r++) {
+            const int64_t* row = &buffer[r * rowLength];
+            out << row[0];
+            for (size_t i = 1; i < rowLength; i++) {
+                out << ',' << row[i];
+            }
+            out << '\n';
+        }
+    }
+    rows = 0;
+    if (!out) {
+        throw runtime_error("error writing interval statistics: " + fileName);
+    }
+}
+
+void IntervalStatsWriter::finish() {
+    flush();
+    out.close();
+}
@@ -0,0 +1,78 @@
+#ifndef INTERVAL_STATS_H
+#define INTERVAL_STATS_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+//
+// Time series of the simulation: the counters gained in every interval of a fixed number of
+// cycles. The simulator hands over cumulative counters at each interval boundary; the writer
+// keeps the differences in a preallocated buffer and streams it to the file whenever it fills,
+// so a boundary costs a few dozen additions and memory does not grow with the run.
+//
+// A row holds, for the cycles [start_cycle, end_cycle]: bus busy cycles, bus transactions and
+// bus traffic, then hits, misses, idle cycles and invalidating requests of every core.
+//
+enum IntervalBusField {
+    INTERVAL_BUS_BUSY_CYCLES,
+    INTERVAL_BUS_TRANSACTIONS,
+    INTERVAL_BUS_TRAFFIC, // in bytes
+    NUM_INTERVAL_BUS_FIELDS
+};
+
+enum IntervalCoreField {
+    INTERVAL_HITS,
+    INTERVAL_MISSES,
+    INTERVAL_IDLE_CYCLES,
+    INTERVAL_INVALIDATIONS,
+    NUM_INTERVAL_CORE_FIELDS
+};
+
+//
+// Binary interval file (.l1is), little endian:
+//   IntervalStatsHeader
+//   rows of int64: start_cycle, end_cycle, NUM_INTERVAL_BUS_FIELDS bus values,
+//                  numCores x NUM_INTERVAL_CORE_FIELDS core values
+// Any other file name gets the same rows as CSV with a header line.
+//
+const char INTERVAL_STATS_MAGIC[4] = { 'L', '1', 'I', 'S' };
+const uint32_t INTERVAL_STATS_VERSION = 1;
+const char* const INTERVAL_STATS_EXTENSION = ".l1is";
+
+struct IntervalStatsHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numCores;
+    uint32_t intervalCycles;
+    uint32_t busFields;
+    uint32_t coreFields;
+};
+
+class IntervalStatsWriter {
+private:
+    std::ofstream out;
+    std::string fileName;
+    bool binary;
+    size_t valuesPerRow;           // bus and core values, without the two cycle columns
+    std::vector<int64_t> previous; // cumulative values at the last boundary
+    int64_t previousCycle;
+    std::vector<int64_t> buffer;   // rows waiting to be written
+    size_t rows;
+    size_t capacityRows;
+
+    void flush();
+
+public:
+    IntervalStatsWriter(const std::string& fileName, int numCores, int intervalCycles);
+    ~IntervalStatsWriter();
+    size_t valuesPerSnapshot() const { return valuesPerRow; }
+    // Cumulative values at the start of `cycle`: bus fields, then each core's fields. The first
+    // call sets the baseline, every later one adds the row for [previous cycle, cycle - 1].
+    void record(int64_t cycle, const int64_t* cumulative);
+    // Writes the buffered rows and closes the file
+    void finish();
+};
+
+#endif // INTERVAL_STATS_H
@@ -0,0 +1,33 @@
+#ifndef LOG_H
+#define LOG_H
+
+//
+// Text log of the simulator, one line per message: "[Cycle N] message". Each message has a level;
+// it is printed when the level is at most the run's logLevel (-d or --log-level) and compiled in
+// at all only up to L1SIM_LOG_LEVEL (make LOG_LEVEL=0 builds without any). The message expression
+// is evaluated only when it is printed, so a disabled message costs one comparison, or nothing
+// when compiled out.
+//
+// The macros are meant for CacheSimulator members: they use its logLevel and debugPrint.
+//
+enum LogLevel {
+    LOG_LEVEL_OFF = 0,
+    LOG_LEVEL_INFO = 1,  // setup, misses, bus transactions, coherence state changes, evictions
+    LOG_LEVEL_DEBUG = 2, // every access, stall and retirement
+    LOG_LEVEL_TRACE = 3  // every cycle
+};
+
+#ifndef L1SIM_LOG_LEVEL
+#define L1SIM_LOG_LEVEL 3
+#endif
+
+#define SIM_LOG(level, message) \
+    do { \
+        if ((level) <= L1SIM_LOG_LEVEL && (level) <= logLevel) debugPrint(message); \
+    } while (0)
+
+#define LOG_INFO(message) SIM_LOG(LOG_LEVEL_INFO, message)
+#define LOG_DEBUG(message) SIM_LOG(LOG_LEVEL_DEBUG, message)
+#define LOG_TRACE(message) SIM_LOG(LOG_LEVEL_TRACE, message)
+
+#endif // LOG_H
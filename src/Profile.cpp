@@ -0,0 +1,61 @@
+#include "Profile.h"
+#include <iomanip>
+using namespace std;
+
+static const char* const REGION_NAMES[NUM_PROFILE_REGIONS] = {
+    "Trace Decode", "Local Lookup", "Remote Snoop", "Bus Arbitration", "Statistics Update"
+};
+
+static const char* const EVENT_NAMES[NUM_PROFILE_EVENTS] = {
+    "Read Hits", "Write Hits", "Write Upgrades (S -> M)",
+    "Read Misses, no other copy", "Read Misses, other copies S", "Read Misses, other copy E",
+    "Read Misses, other copy M",
+    "Write Misses, no other copy", "Write Misses, other copies S", "Write Misses, other copy E",
+    "Write Misses, other copy M"
+};
+
+static const char* const STALL_NAMES[NUM_STALL_CAUSES] = {
+    "Bus Busy", "Memory", "Cache-to-Cache", "Writeback"
+};
+
+void ProfileCounters::add(const ProfileCounters& other) {
+    for (int i = 0; i < NUM_PROFILE_REGIONS; i++) {
+        calls[i] += other.calls[i];
+        timedCalls[i] += other.timedCalls[i];
+        ticks[i] += other.ticks[i];
+    }
+    for (int i = 0; i < NUM_PROFILE_EVENTS; i++) events[i] += other.events[i];
+    for (int i = 0; i < NUM_STALL_CAUSES; i++) stallCycles[i] += other.stallCycles[i];
+}
+
+void printProfile(ostream& out, const ProfileCounters& counters, const ProfileClock& run, long long idleCycles) {
+    double nsPerTick = (run.ticks > 0) ? run.nanoseconds / (double)run.ticks : 0.0;
+    out << "Simulator Profile (sampled timers, 1 call in " << PROFILE_SAMPLE_PERIOD << "):" << endl;
+    out << "Simulate Time (ms): " << fixed << setprecision(3) << run.nanoseconds / 1e6 << endl;
+    double timedNs = 0.0;
+    for (int i = 0; i < NUM_PROFILE_REGIONS; i++) {
+        // Extrapolate the timed calls to all of them
+        double ns = (counters.timedCalls[i] > 0)
+            ? (double)counters.ticks[i] * nsPerTick * (double)counters.calls[i] / (double)counters.timedCalls[i]
+            : 0.0;
+        timedNs += ns;
+        double share = (run.nanoseconds > 0) ? 100.0 * ns / run.nanoseconds : 0.0;
+        double perCall = (counters.calls[i] > 0) ? ns / (double)counters.calls[i] : 0.0;
+        out << REGION_NAMES[i] << ": " << counters.calls[i] << " calls, " << setprecision(3) << ns / 1e6
+            << " ms (" << setprecision(1) << share << "%), " << perCall << " ns/call" << endl;
+    }
+    double rest = run.nanoseconds - timedNs;
+    out << "Engine and Untimed: " << setprecision(3) << rest / 1e6 << " ms ("
+        << setprecision(1) << ((run.nanoseconds > 0) ? 100.0 * rest / run.nanoseconds : 0.0) << "%)" << endl;
+
+    for (int i = 0; i < NUM_PROFILE_EVENTS; i++) {
+        out << EVENT_NAMES[i] << ": " << counters.events[i] << endl;
+    }
+
+    uint64_t stalled = 0;
+    for (int i = 0; i < NUM_STALL_CAUSES; i++) {
+        out << "Stall Cycles, " << STALL_NAMES[i] << ": " << counters.stallCycles[i] << endl;
+        stalled += counters.stallCycles[i];
+    }
+    out << "Stall Cycles, Total: " << stalled << " (Idle Cycles: " << idleCycles << ")" << endl;
+}
@@ -0,0 +1,124 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//
+// Hot-path profile of the simulator itself, compiled in only with -DL1SIM_PROFILE (make PROFILE=1).
+// Without it the PROFILE_* macros expand to nothing and their arguments are not evaluated.
+//
+// Regions are timed with the time-stamp counter (steady_clock where there is none). Every call
+// of a region is counted, but only one call in PROFILE_SAMPLE_PERIOD reads the clock; the time of
+// the region is extrapolated from those. The regions are short (a tag lookup is a few tens of
+// nanoseconds) and reading the clock around each of them would cost as much as the work.
+// In parallel mode the region times add up over the worker threads.
+//
+enum ProfileRegion {
+    PROFILE_TRACE_DECODE,    // TraceSource::nextChunk
+    PROFILE_LOCAL_LOOKUP,    // own cache lookup and hit handling
+    PROFILE_REMOTE_SNOOP,    // directory lookup and state changes of the other caches
+    PROFILE_BUS_ARBITRATION, // busy-bus checks, waiter wake-ups and grants
+    PROFILE_STATISTICS,      // counters updated when an instruction retires
+    NUM_PROFILE_REGIONS
+};
+
+// Outcome of every access, the misses split by the state of the other copies they found
+enum ProfileEvent {
+    PROFILE_READ_HIT,
+    PROFILE_WRITE_HIT,
+    PROFILE_WRITE_UPGRADE,    // write to an own SHARED copy
+    PROFILE_READ_MISS_I,      // no other copy: fetched from memory
+    PROFILE_READ_MISS_S,
+    PROFILE_READ_MISS_E,
+    PROFILE_READ_MISS_M,
+    PROFILE_WRITE_MISS_I,
+    PROFILE_WRITE_MISS_S,
+    PROFILE_WRITE_MISS_E,
+    PROFILE_WRITE_MISS_M,
+    NUM_PROFILE_EVENTS
+};
+
+// What a core's idle cycles were spent waiting for
+enum StallCause {
+    STALL_BUS_BUSY,       // another core held the bus
+    STALL_MEMORY,         // block fetched from memory
+    STALL_CACHE_TO_CACHE, // block transferred from another cache
+    STALL_WRITEBACK,      // own victim, or the remote owner's copy, written back first
+    NUM_STALL_CAUSES
+};
+
+const uint64_t PROFILE_SAMPLE_PERIOD = 64; // power of two
+
+struct ProfileCounters {
+    uint64_t calls[NUM_PROFILE_REGIONS];
+    uint64_t timedCalls[NUM_PROFILE_REGIONS];
+    uint64_t ticks[NUM_PROFILE_REGIONS]; // of the timed calls
+    uint64_t events[NUM_PROFILE_EVENTS];
+    uint64_t stallCycles[NUM_STALL_CAUSES];
+
+    ProfileCounters() : calls(), timedCalls(), ticks(), events(), stallCycles() {}
+    void add(const ProfileCounters& other);
+};
+
+inline uint64_t profileTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Times the enclosing scope on one call in PROFILE_SAMPLE_PERIOD, or on every call if `always`
+class ProfileTimer {
+private:
+    ProfileCounters& counters;
+    ProfileRegion region;
+    bool timed;
+    uint64_t start;
+
+public:
+    ProfileTimer(ProfileCounters& counters, ProfileRegion region, bool always = false)
+        : counters(counters), region(region), timed(always || (counters.calls[region] & (PROFILE_SAMPLE_PERIOD - 1)) == 0),
+          start(0) {
+        counters.calls[region]++;
+        if (timed) start = profileTicks();
+    }
+    ~ProfileTimer() {
+        if (timed) {
+            counters.ticks[region] += profileTicks() - start;
+            counters.timedCalls[region]++;
+        }
+    }
+};
+
+// Wall time and ticks of a whole run, to convert ticks to nanoseconds
+struct ProfileClock {
+    uint64_t ticks;
+    double nanoseconds;
+};
+
+// The "Simulator Profile" section of printStatistics; idleCycles is the total the stall causes
+// should add up to
+void printProfile(std::ostream& out, const ProfileCounters& counters, const ProfileClock& run, long long idleCycles);
+
+#ifdef L1SIM_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(counters, region) ProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)((counters), (region))
+#define PROFILE_SCOPE_ALWAYS(counters, region) ProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)((counters), (region), true)
+#define PROFILE_EVENT(counters, event) ((counters).events[(event)]++)
+#define PROFILE_STALL(counters, cause, cycles) ((counters).stallCycles[(cause)] += (uint64_t)(cycles))
+#else
+#define PROFILE_SCOPE(counters, region) do {} while (0)
+#define PROFILE_SCOPE_ALWAYS(counters, region) do {} while (0)
+#define PROFILE_EVENT(counters, event) do {} while (0)
+#define PROFILE_STALL(counters, cause, cycles) do {} while (0)
+#endif
+
+#endif // PROFILE_H
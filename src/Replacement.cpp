@@ -0,0 +1,22 @@
+#include "Replacement.h"
+#include <stdexcept>
+using namespace std;
+
+ReplacementPolicy parseReplacementPolicy(const string& name) {
+    if (name == "lru") return REPLACEMENT_LRU;
+    if (name == "plru") return REPLACEMENT_PLRU;
+    if (name == "srrip") return REPLACEMENT_SRRIP;
+    if (name == "brrip") return REPLACEMENT_BRRIP;
+    if (name == "random") return REPLACEMENT_RANDOM;
+    throw invalid_argument("unknown replacement policy: " + name + " (lru, plru, srrip, brrip or random)");
+}
+
+const char* replacementPolicyName(ReplacementPolicy policy) {
+    switch (policy) {
+        case REPLACEMENT_PLRU: return "Tree-PLRU";
+        case REPLACEMENT_SRRIP: return "SRRIP";
+        case REPLACEMENT_BRRIP: return "BRRIP";
+        case REPLACEMENT_RANDOM: return "Random";
+        default: return "LRU";
+    }
+}
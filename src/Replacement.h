@@ -0,0 +1,44 @@
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <string>
+
+//
+// Replacement policies of the private caches. Each keeps its own metadata in the cache arena:
+//   LRU      64-bit use stamp per line; the victim is the oldest stamp of the set
+//   PLRU     tree-PLRU, ways - 1 bits per set (power-of-two associativity up to 64)
+//   SRRIP    2-bit re-reference prediction value (RRPV) per line, fills predicted "long"
+//   BRRIP    as SRRIP, but fills mostly "distant" so a streaming scan cannot flush the set
+//   RANDOM   no metadata; a per-cache xorshift generator picks the victim
+// An empty way is always filled first. The policy is chosen at run time (--replacement), or
+// fixed at compile time with make REPLACEMENT=<name>, which removes the dispatch on hits. The
+// fixed policy is a build macro rather than a template parameter of Cache: the simulator, the
+// shared L2 and checkpoints hold caches by value and pick the policy at run time, so a Cache
+// per policy would have to be one type anyway. The macro instantiates the same per-policy
+// code (Cache::touchAs/allocateAs) the runtime dispatch switches between.
+//
+enum ReplacementPolicy {
+    REPLACEMENT_LRU,
+    REPLACEMENT_PLRU,
+    REPLACEMENT_SRRIP,
+    REPLACEMENT_BRRIP,
+    REPLACEMENT_RANDOM
+};
+
+#ifdef L1SIM_REPLACEMENT
+const ReplacementPolicy DEFAULT_REPLACEMENT = L1SIM_REPLACEMENT;
+#else
+const ReplacementPolicy DEFAULT_REPLACEMENT = REPLACEMENT_LRU;
+#endif
+
+// RRIP parameters: RRPVs are 0 (near re-reference) .. RRPV_MAX (distant)
+const unsigned char RRPV_MAX = 3;
+const unsigned char RRPV_LONG = RRPV_MAX - 1;
+const unsigned int BRRIP_LONG_ONE_IN = 32; // BRRIP fills with RRPV_LONG once in this many
+
+// "lru", "plru", "srrip", "brrip" or "random"
+ReplacementPolicy parseReplacementPolicy(const std::string& name);
+// As printed in the statistics header, e.g. "Tree-PLRU"
+const char* replacementPolicyName(ReplacementPolicy policy);
+
+#endif // REPLACEMENT_H
@@ -0,0 +1,93 @@
+#include "Sampling.h"
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+std::string SamplingConfig::describe() const {
+    std::ostringstream oss;
+    if (setSampling()) {
+        oss << "1 in " << setRatio << " sets";
+    }
+    if (intervalSampling()) {
+        if (setSampling()) oss << ", ";
+        oss << detailedRefs << " detailed (after " << warmupRefs << " warm-up) / " << warmingRefs
+            << " warming references per interval";
+    }
+    return oss.str();
+}
+
+SamplingConfig parseIntervalSpec(const std::string& spec) {
+    SamplingConfig config;
+    size_t comma = spec.find(',');
+    if (comma == std::string::npos) {
+        throw std::invalid_argument("interval sampling expects <detailed>,<warming>[,<warmup>]: " + spec);
+    }
+    size_t second = spec.find(',', comma + 1);
+    config.detailedRefs = std::stoll(spec.substr(0, comma));
+    config.warmingRefs = std::stoll(spec.substr(comma + 1, second - comma - 1));
+    config.warmupRefs = (second == std::string::npos) ? config.detailedRefs : std::stoll(spec.substr(second + 1));
+    if (config.detailedRefs <= 0 || config.warmingRefs < 0 || config.warmupRefs < 0) {
+        throw std::invalid_argument("invalid interval sampling window sizes: " + spec);
+    }
+    return config;
+}
+
+int SampleEstimator::addUnit(bool exactUnit) {
+    values.resize(values.size() + (size_t)rows * NUM_SAMPLED_STATS, 0.0);
+    exact.push_back(exactUnit);
+    return (int)numUnits++;
+}
+
+double SampleEstimator::sum(int row, int stat) const {
+    double total = 0.0;
+    for (size_t u = 0; u < numUnits; u++) {
+        total += at(u, row, stat);
+    }
+    return total;
+}
+
+SampleEstimate SampleEstimator::estimate(int row, int stat, double populationReferences) const {
+    SampleEstimate result = { 0.0, 0.0 };
+    double exactValues = 0.0;
+    double exactReferences = 0.0;
+    for (size_t u = 0; u < numUnits; u++) {
+        if (exact[u]) {
+            exactValues += at(u, row, stat);
+            exactReferences += at(u, row, SAMPLED_REFERENCES);
+        }
+    }
+    double sumValues = sum(row, stat) - exactValues;
+    double sumReferences = sum(row, SAMPLED_REFERENCES) - exactReferences;
+    populationReferences -= exactReferences;
+    result.total = exactValues;
+    if (sumReferences == 0.0) {
+        result.halfWidth = (sumValues == 0.0) ? 0.0 : std::numeric_limits<double>::infinity();
+        return result;
+    }
+
+    // Sampled units in which the row took part; the others say nothing about it
+    size_t n = 0;
+    for (size_t u = 0; u < numUnits; u++) {
+        if (!exact[u] && (at(u, row, SAMPLED_REFERENCES) != 0.0 || at(u, row, stat) != 0.0)) n++;
+    }
+    double ratio = sumValues / sumReferences;
+    result.total += ratio * populationReferences;
+    // Units the population amounts to, at the sampled mean of references per unit
+    double populationUnits = std::max(populationReferences / (sumReferences / n), (double)n);
+    if (n < 2) {
+        result.halfWidth = (populationUnits > n) ? std::numeric_limits<double>::infinity() : 0.0;
+        return result;
+    }
+    double residuals = 0.0;
+    for (size_t u = 0; u < numUnits; u++) {
+        if (exact[u]) continue;
+        double d = at(u, row, stat) - ratio * at(u, row, SAMPLED_REFERENCES);
+        residuals += d * d;
+    }
+    double variance = residuals / (n - 1);
+    double fpc = 1.0 - n / populationUnits;
+    result.halfWidth = SAMPLING_CONFIDENCE_Z * populationUnits * std::sqrt(variance / n * fpc);
+    return result;
+}
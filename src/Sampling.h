@@ -0,0 +1,92 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+//
+// Sampled simulation. Set sampling simulates only the references that map to one set in every
+// setRatio; the others retire in zero cycles without touching the caches. Interval sampling
+// (SMARTS style) alternates windows of detailedRefs references simulated in full with windows of
+// warmingRefs references that only update cache and coherence state; each detailed window starts
+// with warmupRefs references simulated in full but not measured. Either way, the estimated
+// statistics are extrapolated from per-unit samples (a sampled set, or a detailed window) and
+// reported with a confidence interval.
+//
+struct SamplingConfig {
+    int setRatio;           // 1 = every set
+    long long detailedRefs; // 0 = no interval sampling
+    long long warmingRefs;
+    long long warmupRefs;   // detailed warm-up before each measured window
+
+    SamplingConfig() : setRatio(1), detailedRefs(0), warmingRefs(0), warmupRefs(0) {}
+    bool setSampling() const { return setRatio > 1; }
+    bool intervalSampling() const { return detailedRefs > 0; }
+    bool enabled() const { return setSampling() || intervalSampling(); }
+    std::string describe() const;
+};
+
+// Parses the -I argument "<detailed>,<warming>[,<warmup>]"; the warm-up defaults to detailed
+SamplingConfig parseIntervalSpec(const std::string& spec);
+
+// Statistics estimated from samples: one row per core...
+enum SampledStat {
+    SAMPLED_IDLE_CYCLES,
+    SAMPLED_MISSES,
+    SAMPLED_EVICTIONS,
+    SAMPLED_WRITEBACKS,
+    SAMPLED_INVALIDATIONS,
+    SAMPLED_TRAFFIC,
+    SAMPLED_REFERENCES, // references retired in the unit, in every row
+    NUM_SAMPLED_STATS
+};
+
+// ...and one more row (index numCores) for the bus totals and elapsed time
+enum SampledBusStat {
+    SAMPLED_BUS_TRANSACTIONS,
+    SAMPLED_BUS_TRAFFIC,
+    SAMPLED_ELAPSED_CYCLES // interval sampling only
+};
+
+// Estimate of a population total and the half-width of its confidence interval (infinite when
+// fewer than two units sampled the statistic)
+struct SampleEstimate {
+    double total;
+    double halfWidth;
+};
+
+//
+// Per-unit sample values: units x rows x NUM_SAMPLED_STATS. A total is estimated with the ratio
+// estimator against the row's reference count, whose population total is known exactly: the
+// statistic per sampled reference times the references of the whole run. This stays unbiased
+// when a core's references are spread unevenly over the units (a core that wins the bus early
+// finishes in the first windows). The confidence interval is the usual normal approximation for
+// a ratio estimate with the finite population correction. An exact unit holds every reference of
+// its part of the run (the cold start of interval sampling); it is added as counted and only the
+// rest of the population is estimated from the other units.
+//
+class SampleEstimator {
+private:
+    int rows;
+    std::vector<double> values;
+    std::vector<bool> exact;
+    size_t numUnits;
+
+    double at(size_t unit, int row, int stat) const { return values[(unit * rows + row) * NUM_SAMPLED_STATS + stat]; }
+
+public:
+    explicit SampleEstimator(int rows) : rows(rows), numUnits(0) {}
+    // Appends a unit of zeros and returns its index
+    int addUnit(bool exactUnit = false);
+    size_t units() const { return numUnits; }
+    void add(int unit, int row, int stat, double value) {
+        values[((size_t)unit * rows + row) * NUM_SAMPLED_STATS + stat] += value;
+    }
+    double sum(int row, int stat) const;
+    SampleEstimate estimate(int row, int stat, double populationReferences) const;
+};
+
+const double SAMPLING_CONFIDENCE_Z = 1.96; // 95% two-sided
+
+#endif // SAMPLING_H
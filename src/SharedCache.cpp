@@ -0,0 +1,100 @@
+#include "SharedCache.h"
+#include <stdexcept>
+#include <sstream>
+#include <cstdlib>
+using namespace std;
+
+const char* inclusionPolicyName(InclusionPolicy inclusion) {
+    switch (inclusion) {
+        case INCLUSION_NON_INCLUSIVE: return "non-inclusive";
+        case INCLUSION_EXCLUSIVE: return "exclusive";
+        default: return "inclusive";
+    }
+}
+
+string SharedCacheConfig::describe() const {
+    ostringstream out;
+    if (sizeBytes % (1 << 20) == 0) out << (sizeBytes >> 20) << " MB";
+    else out << (sizeBytes >> 10) << " KB";
+    out << ", " << ways << "-way, " << latency << " cycles, " << banks << (banks == 1 ? " bank, " : " banks, ")
+        << inclusionPolicyName(inclusion);
+    return out.str();
+}
+
+// Positive number with an optional K, M or G (binary) suffix
+static uint64_t parseSize(const string& key, const string& value) {
+    char* end = nullptr;
+    unsigned long long n = strtoull(value.c_str(), &end, 10);
+    if (end == value.c_str() || value[0] == '-' || n == 0) {
+        throw invalid_argument("invalid L2 " + key + ": " + value);
+    }
+    string suffix(end);
+    if (suffix == "K" || suffix == "k") n <<= 10;
+    else if (suffix == "M" || suffix == "m") n <<= 20;
+    else if (suffix == "G" || suffix == "g") n <<= 30;
+    else if (!suffix.empty()) throw invalid_argument("invalid L2 " + key + ": " + value);
+    return n;
+}
+
+// Plain decimal number of at least min
+static int parseNumber(const string& key, const string& value, int min) {
+    char* end = nullptr;
+    long n = strtol(value.c_str(), &end, 10);
+    if (end == value.c_str() || *end != '\0' || n < min || n > 1000000) {
+        throw invalid_argument("invalid L2 " + key + ": " + value);
+    }
+    return (int)n;
+}
+
+SharedCacheConfig parseSharedCacheSpec(const string& spec) {
+    SharedCacheConfig config;
+    stringstream ss(spec);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == string::npos) {
+            throw invalid_argument("malformed L2 parameter: " + item);
+        }
+        string key = item.substr(0, eq);
+        string value = item.substr(eq + 1);
+        if (key == "size") config.sizeBytes = parseSize(key, value);
+        else if (key == "ways") config.ways = parseNumber(key, value, 1);
+        else if (key == "latency") config.latency = parseNumber(key, value, 0);
+        else if (key == "banks") config.banks = parseNumber(key, value, 1);
+        else if (key == "inclusion") {
+            if (value == "inclusive") config.inclusion = INCLUSION_INCLUSIVE;
+            else if (value == "non-inclusive") config.inclusion = INCLUSION_NON_INCLUSIVE;
+            else if (value == "exclusive") config.inclusion = INCLUSION_EXCLUSIVE;
+            else throw invalid_argument("unknown L2 inclusion: " + value + " (inclusive, non-inclusive or exclusive)");
+        }
+        else throw invalid_argument("unknown L2 parameter '" + key + "'");
+    }
+    if (!config.enabled()) {
+        throw invalid_argument("the L2 needs a size: " + spec);
+    }
+    return config;
+}
+
+int SharedCache::setBitsOf(const SharedCacheConfig& config, int blockBits) {
+    uint64_t setBytes = (uint64_t)config.ways << blockBits;
+    uint64_t numSets = config.sizeBytes / setBytes;
+    if (config.sizeBytes % setBytes != 0 || numSets == 0 || (numSets & (numSets - 1)) != 0) {
+        throw invalid_argument("L2 size must be a power-of-two number of sets of " + to_string(config.ways) +
+                               " blocks of " + to_string(1 << blockBits) + " bytes");
+    }
+    if (config.banks <= 0 || (config.banks & (config.banks - 1)) != 0 || (uint64_t)config.banks > numSets) {
+        throw invalid_argument("L2 banks must be a power of two no larger than the number of sets");
+    }
+    int bits = 0;
+    while (((uint64_t)1 << bits) < numSets) bits++;
+    if (bits + blockBits > 31) {
+        throw invalid_argument("L2 size must be below 2 GB");
+    }
+    return bits;
+}
+
+SharedCache::SharedCache(const SharedCacheConfig& config, int blockBits, int id, ReplacementPolicy policy)
+    : cache(id, setBitsOf(config, blockBits), config.ways, blockBits, false, policy), config(config),
+      stats(SharedCacheStats()), setBits(setBitsOf(config, blockBits)), bankMask((uint64_t)config.banks - 1),
+      bankNextFree(config.banks, 0LL) {
+}
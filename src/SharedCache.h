@@ -0,0 +1,87 @@
+#ifndef SHARED_CACHE_H
+#define SHARED_CACHE_H
+
+#include "Cache.h"
+#include "Replacement.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//
+// Optional shared last-level cache behind the private L1s. It serves the fetches the L1s would
+// otherwise send to memory and absorbs their write backs; its own misses and dirty evictions go to
+// memory. Blocks are the L1 block size. Inclusion modes:
+//   inclusive      every L1 block is also in the L2; evicting an L2 block back-invalidates the
+//                  L1 copies (a MODIFIED one is written back with it)
+//   non-inclusive  fetched blocks are allocated in the L2, but its evictions leave the L1s alone
+//   exclusive      the L2 holds only blocks no L1 has: a hit moves the block up to the L1, and the
+//                  last L1 copy of a block moves down when it is evicted
+// The coherence side (back-invalidation, exclusivity) is handled by CacheSimulator.
+//
+enum InclusionPolicy {
+    INCLUSION_INCLUSIVE,
+    INCLUSION_NON_INCLUSIVE,
+    INCLUSION_EXCLUSIVE
+};
+
+struct SharedCacheConfig {
+    uint64_t sizeBytes; // 0 = no L2
+    int ways;
+    int latency;        // cycles of one lookup, during which its bank is busy
+    int banks;          // interleaved by set, a power of two
+    InclusionPolicy inclusion;
+
+    SharedCacheConfig() : sizeBytes(0), ways(8), latency(12), banks(1), inclusion(INCLUSION_INCLUSIVE) {}
+    bool enabled() const { return sizeBytes > 0; }
+    std::string describe() const;
+};
+
+// Parses the --l2 argument, e.g. "size=256K,ways=8,latency=12,banks=4,inclusion=exclusive";
+// keys left out keep their defaults, size is required
+SharedCacheConfig parseSharedCacheSpec(const std::string& spec);
+const char* inclusionPolicyName(InclusionPolicy inclusion);
+
+struct SharedCacheStats {
+    long long hits;               // fetches for L1 fills
+    long long misses;
+    long long writes;             // L1 write backs (and, exclusive, clean victims) received
+    long long evictions;
+    long long memoryWritebacks;   // dirty blocks evicted to memory
+    long long backInvalidations;  // L1 copies invalidated by inclusive evictions
+    long long bankConflictCycles; // lookups waiting for a busy bank
+};
+
+class SharedCache {
+public:
+    Cache cache;          // tag store; clean blocks are EXCLUSIVE, dirty ones MODIFIED
+    SharedCacheConfig config;
+    SharedCacheStats stats;
+
+    // id only seeds the replacement generator; blockBits is the L1 block size
+    SharedCache(const SharedCacheConfig& config, int blockBits, int id, ReplacementPolicy policy);
+
+    // Cycle in which a lookup of block issued in the given cycle completes, queueing behind earlier
+    // lookups of the same bank
+    long long bankAccess(long long cycle, uint64_t block) {
+        long long& bankFree = bankNextFree[block & bankMask];
+        long long start = (cycle > bankFree) ? cycle : bankFree;
+        stats.bankConflictCycles += start - cycle;
+        bankFree = start + config.latency;
+        return bankFree;
+    }
+    // Forgets the bank timing, after untimed (functional) accesses
+    void resetTiming() { std::fill(bankNextFree.begin(), bankNextFree.end(), 0LL); }
+    std::vector<long long>& bankTimes() { return bankNextFree; }
+    const std::vector<long long>& bankTimes() const { return bankNextFree; }
+    int setIndexBits() const { return setBits; }
+
+private:
+    int setBits;          // log2 of the number of sets
+    uint64_t bankMask;
+    std::vector<long long> bankNextFree;
+
+    // Set index bits of the configured size, checking the configuration
+    static int setBitsOf(const SharedCacheConfig& config, int blockBits);
+};
+
+#endif // SHARED_CACHE_H
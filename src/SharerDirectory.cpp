@@ -0,0 +1,130 @@
+#include "SharerDirectory.h"
+using namespace std;
+
+static const size_t MIN_CAPACITY = 64;
+// Initial tables stay small for huge configurations; they double on demand
+static const size_t MAX_INITIAL_CAPACITY = (size_t)1 << 20;
+
+SharerDirectory::SharerDirectory(int numCores, size_t expectedBlocks)
+    : wordsPerEntry((numCores + 63) / 64), mask(0), hashShift(64), size(0) {
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < 2 * expectedBlocks && capacity < MAX_INITIAL_CAPACITY) {
+        capacity *= 2;
+    }
+    resize(capacity);
+}
+
+void SharerDirectory::resize(size_t capacity) {
+    std::vector<Entry> oldEntries;
+    std::vector<uint64_t> oldBits;
+    oldEntries.swap(entries);
+    oldBits.swap(sharerBits);
+
+    Entry empty = { EMPTY_BLOCK, -1, 0 };
+    entries.assign(capacity, empty);
+    sharerBits.assign(capacity * wordsPerEntry, 0);
+    mask = capacity - 1;
+    hashShift = 64;
+    for (size_t c = capacity; c > 1; c >>= 1) {
+        hashShift--;
+    }
+    size = 0;
+
+    for (size_t i = 0; i < oldEntries.size(); i++) {
+        if (oldEntries[i].block == EMPTY_BLOCK) continue;
+        size_t index = insert(oldEntries[i].block);
+        entries[index] = oldEntries[i];
+        std::copy(&oldBits[i * wordsPerEntry], &oldBits[(i + 1) * wordsPerEntry], bitsOf(index));
+    }
+}
+
+int SharerDirectory::find(uint64_t block) const {
+    for (size_t i = home(block); ; i = (i + 1) & mask) {
+        if (entries[i].block == block) return (int)i;
+        if (entries[i].block == EMPTY_BLOCK) return -1;
+    }
+}
+
+// Slot for a block known to be absent; grows the table first if it would pass half full
+size_t SharerDirectory::insert(uint64_t block) {
+    if (2 * (size + 1) > entries.size()) {
+        resize(2 * entries.size());
+    }
+    size_t i = home(block);
+    while (entries[i].block != EMPTY_BLOCK) {
+        i = (i + 1) & mask;
+    }
+    entries[i].block = block;
+    entries[i].owner = -1;
+    entries[i].sharerCount = 0;
+    size++;
+    return i;
+}
+
+// Backward-shift deletion: later entries of the probe run move up so lookups never need tombstones
+void SharerDirectory::erase(size_t index) {
+    size_t hole = index;
+    for (size_t i = (hole + 1) & mask; entries[i].block != EMPTY_BLOCK; i = (i + 1) & mask) {
+        size_t h = home(entries[i].block);
+        // Entry i may fill the hole unless its home lies cyclically in (hole, i]
+        bool homeBetween = (hole <= i) ? (h > hole && h <= i) : (h > hole || h <= i);
+        if (!homeBetween) {
+            entries[hole] = entries[i];
+            std::copy(bitsOf(i), bitsOf(i) + wordsPerEntry, bitsOf(hole));
+            hole = i;
+        }
+    }
+    entries[hole].block = EMPTY_BLOCK;
+    std::fill(bitsOf(hole), bitsOf(hole) + wordsPerEntry, (uint64_t)0);
+    size--;
+}
+
+void SharerDirectory::setState(uint64_t block, int coreId, CacheLineState state) {
+    int found = find(block);
+    uint64_t bit = (uint64_t)1 << (coreId & 63);
+    if (state == INVALID) {
+        if (found < 0) return;
+        Entry &entry = entries[found];
+        uint64_t &word = bitsOf(found)[coreId >> 6];
+        if (word & bit) {
+            word &= ~bit;
+            entry.sharerCount--;
+        }
+        if (entry.owner == coreId) {
+            entry.owner = -1;
+        }
+        if (entry.sharerCount == 0) {
+            erase(found);
+        }
+        return;
+    }
+
+    size_t index = (found < 0) ? insert(block) : (size_t)found;
+    Entry &entry = entries[index];
+    uint64_t &word = bitsOf(index)[coreId >> 6];
+    if (!(word & bit)) {
+        word |= bit;
+        entry.sharerCount++;
+    }
+    if (state == SHARED) {
+        if (entry.owner == coreId) {
+            entry.owner = -1;
+        }
+    } else {
+        entry.owner = coreId;
+    }
+}
+
+int SharerDirectory::firstSharer(int entry) const {
+    const uint64_t* bits = bitsOf(entry);
+    for (int w = 0; w < wordsPerEntry; w++) {
+        if (bits[w]) {
+            return w * 64 + __builtin_ctzll(bits[w]);
+        }
+    }
+    return -1;
+}
+
+void SharerDirectory::copySharers(int entry, std::vector<uint64_t>& out) const {
+    out.assign(bitsOf(entry), bitsOf(entry) + wordsPerEntry);
+}
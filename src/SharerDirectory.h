@@ -0,0 +1,59 @@
+#ifndef SHARER_DIRECTORY_H
+#define SHARER_DIRECTORY_H
+
+#include "utils.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//
+// Global snoop filter: for every block held in at least one private cache, the set of cores
+// holding it and the core holding it EXCLUSIVE or MODIFIED, if any (E and M are not told apart). It is an open-addressing
+// hash table keyed by block number (linear probing, backward-shift deletion) with the sharer
+// bitmasks stored out of line, numCores bits per entry. CacheSimulator keeps it in step with
+// every MESI state change, so a miss finds its owner and sharers without visiting other caches.
+//
+class SharerDirectory {
+private:
+    struct Entry {
+        uint64_t block;     // EMPTY_BLOCK for a free slot
+        int owner;          // core holding the block E or M, -1 when every copy is SHARED
+        int sharerCount;
+    };
+    static const uint64_t EMPTY_BLOCK = ~(uint64_t)0;
+
+    int wordsPerEntry;     // 64-bit words of sharer bits per entry
+    std::vector<Entry> entries;
+    std::vector<uint64_t> sharerBits; // wordsPerEntry words per entry
+    size_t mask;           // capacity - 1, capacity is a power of two
+    int hashShift;
+    size_t size;
+
+    size_t home(uint64_t block) const { return (size_t)((block * 0x9e3779b97f4a7c15ull) >> hashShift); }
+    uint64_t* bitsOf(size_t index) { return &sharerBits[index * wordsPerEntry]; }
+    const uint64_t* bitsOf(size_t index) const { return &sharerBits[index * wordsPerEntry]; }
+    size_t insert(uint64_t block);
+    void erase(size_t index);
+    void resize(size_t capacity);
+
+public:
+    // expectedBlocks sizes the initial table; it grows as needed
+    SharerDirectory(int numCores, size_t expectedBlocks);
+
+    // Records the new state of coreId's copy of block (INVALID drops the core)
+    void setState(uint64_t block, int coreId, CacheLineState state);
+
+    // Entry index of block, or -1 when no cache holds it. Valid until the next setState
+    // that adds or removes a block.
+    int find(uint64_t block) const;
+    int owner(int entry) const { return entries[entry].owner; }
+    int sharerCount(int entry) const { return entries[entry].sharerCount; }
+    // Lowest-numbered core holding the entry's block
+    int firstSharer(int entry) const;
+    // Copies the entry's sharer bitmask, wordsPerEntry() words, for walking while states change
+    void copySharers(int entry, std::vector<uint64_t>& out) const;
+    int sharerWords() const { return wordsPerEntry; }
+    size_t blocks() const { return size; }
+};
+
+#endif // SHARER_DIRECTORY_H
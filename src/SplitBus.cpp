@@ -0,0 +1,128 @@
+#include "SplitBus.h"
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+using namespace std;
+
+string SplitBusConfig::describe() const {
+    ostringstream out;
+    out << "address " << addressCycles << (addressCycles == 1 ? " cycle" : " cycles") << ", data " << dataCycles
+        << " cycles per block, up to " << maxOutstanding << " outstanding";
+    return out.str();
+}
+
+static int parsePositive(const string& key, const string& value) {
+    char* end = nullptr;
+    long n = strtol(value.c_str(), &end, 10);
+    if (end == value.c_str() || *end != '\0' || n <= 0 || n > 1000000) {
+        throw invalid_argument("invalid split bus " + key + ": " + value);
+    }
+    return (int)n;
+}
+
+SplitBusConfig parseSplitBusSpec(const string& spec) {
+    SplitBusConfig config;
+    config.enabled = true;
+    if (spec == "default") {
+        return config;
+    }
+    stringstream ss(spec);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == string::npos) {
+            throw invalid_argument("malformed split bus parameter: " + item);
+        }
+        string key = item.substr(0, eq);
+        string value = item.substr(eq + 1);
+        if (key == "address") config.addressCycles = parsePositive(key, value);
+        else if (key == "data") config.dataCycles = parsePositive(key, value);
+        else if (key == "outstanding") config.maxOutstanding = parsePositive(key, value);
+        else throw invalid_argument("unknown split bus parameter '" + key + "'");
+    }
+    return config;
+}
+
+SplitBus::SplitBus(const SplitBusConfig& busConfig, int blockSize)
+    : config(busConfig), stats(SplitBusStats()), addressNextFree(0), dataNextFree(0) {
+    if (config.dataCycles == 0) {
+        config.dataCycles = max(1, 2 * (blockSize / 4));
+    }
+    transfers.reserve(config.maxOutstanding + 1);
+}
+
+int SplitBus::delayBin(long long delay) {
+    int bin = 0;
+    while (delay > 0 && bin < SPLIT_BUS_DELAY_BINS - 1) {
+        delay >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+string SplitBus::delayBinName(int bin) {
+    if (bin <= 1) return to_string(bin);
+    long long low = 1LL << (bin - 1);
+    if (bin == SPLIT_BUS_DELAY_BINS - 1) return to_string(low) + "+";
+    return to_string(low) + "-" + to_string(2 * low - 1);
+}
+
+void SplitBus::retireCompleted(long long cycle) {
+    while (!transfers.empty() && transfers.front().first <= cycle) {
+        pop_heap(transfers.begin(), transfers.end(), greater<Transfer>());
+        transfers.pop_back();
+    }
+}
+
+long long SplitBus::nextGrant() const {
+    long long next = addressNextFree;
+    if ((int)transfers.size() >= config.maxOutstanding) {
+        next = max(next, transfers.front().first);
+    }
+    return next;
+}
+
+long long SplitBus::grant(long long cycle, long long waited, int latencyCycles, int writebacks) {
+    retireCompleted(cycle);
+    grantAddressOnly(cycle, waited);
+
+    long long ready = addressNextFree + latencyCycles;
+    long long dataStart = max(ready, dataNextFree);
+    long long arrived = dataStart + config.dataCycles;
+    dataNextFree = arrived + (long long)writebacks * config.dataCycles;
+    stats.dataBusyCycles += (long long)(1 + writebacks) * config.dataCycles;
+    stats.dataTransactions++;
+    stats.dataWaitCycles += dataStart - ready;
+    stats.dataWait[delayBin(dataStart - ready)]++;
+
+    transfers.push_back(Transfer(dataNextFree, dataStart));
+    push_heap(transfers.begin(), transfers.end(), greater<Transfer>());
+    stats.peakOutstanding = max(stats.peakOutstanding, (long long)transfers.size());
+    return arrived;
+}
+
+void SplitBus::grantAddressOnly(long long cycle, long long waited) {
+    addressNextFree = cycle + config.addressCycles;
+    stats.transactions++;
+    stats.addressBusyCycles += config.addressCycles;
+    stats.addressWaitCycles += waited;
+    stats.addressWait[delayBin(waited)]++;
+}
+
+// Each transfer holds the data bus from its start to its completion
+long long SplitBus::dataBusyAfter(long long cycle) const {
+    long long busy = 0;
+    for (const Transfer& transfer : transfers) {
+        busy += max(0LL, transfer.first - max(transfer.second, cycle));
+    }
+    return busy;
+}
+
+void SplitBus::restore(long long addressFree, long long dataFree, const vector<Transfer>& inFlight) {
+    addressNextFree = addressFree;
+    dataNextFree = dataFree;
+    transfers = inFlight;
+    make_heap(transfers.begin(), transfers.end(), greater<Transfer>());
+}
@@ -0,0 +1,85 @@
+#ifndef SPLIT_BUS_H
+#define SPLIT_BUS_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+//
+// Split-transaction bus (--split-bus). A transaction holds the address bus only for its request:
+//   address phase   addressCycles on the address bus; snoops and coherence changes happen here
+//   latency         memory, L2 or nothing for a cache-to-cache transfer, off the bus
+//   data phase      dataCycles per block on the data bus, queued behind earlier data phases
+// The requesting core resumes when its block has been transferred. Write backs (of a victim or of
+// a dirty owner) follow the fill on the data bus without stalling the core. At most
+// maxOutstanding transactions are in flight, from their address phase to the end of their last
+// data transfer; the next request is granted once the address bus and a slot are free. Every core
+// still has at most one request of its own.
+//
+struct SplitBusConfig {
+    bool enabled;
+    int addressCycles;
+    int dataCycles;     // 0 = 2 cycles per 4-byte word, the atomic bus's cache-to-cache transfer
+    int maxOutstanding;
+
+    SplitBusConfig() : enabled(false), addressCycles(1), dataCycles(0), maxOutstanding(8) {}
+    std::string describe() const;
+};
+
+// Parses the --split-bus argument, e.g. "address=2,data=16,outstanding=4", or "default"
+SplitBusConfig parseSplitBusSpec(const std::string& spec);
+
+// Delays in power-of-two bins: 0, 1, 2-3, 4-7, ..., and everything from 2^(SPLIT_BUS_DELAY_BINS - 2) up
+const int SPLIT_BUS_DELAY_BINS = 16;
+
+struct SplitBusStats {
+    long long transactions;       // granted, address-only ones included
+    long long addressBusyCycles;
+    long long dataBusyCycles;
+    long long peakOutstanding;
+    long long addressWaitCycles;  // from a core needing the bus to its grant
+    long long dataWaitCycles;     // from a block being ready to its data phase
+    long long dataTransactions;   // transactions with a data phase
+    long long addressWait[SPLIT_BUS_DELAY_BINS];
+    long long dataWait[SPLIT_BUS_DELAY_BINS];
+};
+
+class SplitBus {
+public:
+    SplitBusConfig config; // dataCycles resolved
+    SplitBusStats stats;
+
+    SplitBus(const SplitBusConfig& config, int blockSize);
+
+    // Grants, in cycle, a transaction whose core waited `waited` cycles for it. Its block is ready
+    // latencyCycles after the address phase and writebacks more blocks follow it. Returns the
+    // cycle in which the block has arrived.
+    long long grant(long long cycle, long long waited, int latencyCycles, int writebacks);
+    // Grants a transaction with no data phase (an invalidation broadcast)
+    void grantAddressOnly(long long cycle, long long waited);
+    // First cycle in which another transaction can be granted
+    long long nextGrant() const;
+
+    // Data bus cycles already granted that lie at or after cycle
+    long long dataBusyAfter(long long cycle) const;
+
+    // In-flight transactions as (completion cycle, data phase start) pairs, for checkpoints
+    typedef std::pair<long long, long long> Transfer;
+    const std::vector<Transfer>& inFlight() const { return transfers; }
+    long long addressFree() const { return addressNextFree; }
+    long long dataFree() const { return dataNextFree; }
+    void restore(long long addressFree, long long dataFree, const std::vector<Transfer>& inFlight);
+
+    static int delayBin(long long delay);
+    static std::string delayBinName(int bin);
+
+private:
+    long long addressNextFree;
+    long long dataNextFree;
+    std::vector<Transfer> transfers; // min-heap by completion cycle
+
+    void retireCompleted(long long cycle);
+};
+
+#endif // SPLIT_BUS_H
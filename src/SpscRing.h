@@ -0,0 +1,56 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+//
+// Bounded lock-free ring for exactly one producer thread and one consumer thread. Both sides
+// work on contiguous spans: the producer fills the span returned by writable() and publishes
+// it with commit(); the consumer reads the span returned by readable() and hands it back with
+// release(). A span stays untouched by the other side until it is committed or released.
+// The capacity is rounded up to a power of two.
+//
+template <typename T>
+class SpscRing {
+private:
+    std::vector<T> slots;
+    size_t mask;
+    // Each index is written by one side only; padding keeps them on separate cache lines
+    std::atomic<size_t> head; // next slot to read, advanced by the consumer
+    char padding[64];
+    std::atomic<size_t> tail; // next slot to write, advanced by the producer
+
+public:
+    explicit SpscRing(size_t capacity) : mask(0), head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+    // Producer: free span starting at the write position (up to the end of the storage)
+    size_t writable(T*& span) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t free = slots.size() - (t - head.load(std::memory_order_acquire));
+        size_t contiguous = slots.size() - (t & mask);
+        span = &slots[t & mask];
+        return free < contiguous ? free : contiguous;
+    }
+    void commit(size_t n) { tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+    // Consumer: filled span starting at the read position (up to the end of the storage)
+    size_t readable(const T*& span) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t filled = tail.load(std::memory_order_acquire) - h;
+        size_t contiguous = slots.size() - (h & mask);
+        span = &slots[h & mask];
+        return filled < contiguous ? filled : contiguous;
+    }
+    void release(size_t n) { head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+};
+
+#endif // SPSC_RING_H
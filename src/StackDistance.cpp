@@ -0,0 +1,163 @@
+#include "StackDistance.h"
+#include "Cache.h"
+#include "TraceReader.h"
+#include <unordered_map>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+using namespace std;
+
+// Fenwick tree over reference timestamps; position t holds 1 while the reference at time t
+// is the most recent one to its block, so a range sum counts distinct blocks touched in between
+class FenwickTree {
+private:
+    std::vector<int> tree;
+
+public:
+    explicit FenwickTree(size_t n = 0) : tree(n + 1, 0) {}
+    void add(size_t i, int delta) {
+        for (i++; i < tree.size(); i += i & (~i + 1)) tree[i] += delta;
+    }
+    // Sum of positions [0, i)
+    long long prefix(size_t i) const {
+        long long sum = 0;
+        for (; i > 0; i -= i & (~i + 1)) sum += tree[i];
+        return sum;
+    }
+};
+
+// LRU stack of one group of references (one set, or the whole cache)
+struct DistanceStack {
+    FenwickTree marks;
+    size_t now;
+
+    explicit DistanceStack(size_t references) : marks(references), now(0) {}
+
+    // Records an access at the next timestamp; returns the stack distance, or -1 for a first touch
+    long long access(size_t& lastTime, bool seen) {
+        long long distance = -1;
+        if (seen) {
+            distance = marks.prefix(now) - marks.prefix(lastTime + 1);
+            marks.add(lastTime, -1);
+        }
+        marks.add(now, 1);
+        lastTime = now++;
+        return distance;
+    }
+};
+
+double StackDistanceProfile::missRate(int E) const {
+    if (references == 0) return 0.0;
+    long long misses = coldMisses;
+    for (size_t d = (size_t)E; d < setDistances.size(); d++) misses += setDistances[d];
+    return (double)misses / references;
+}
+
+double StackDistanceProfile::fullyAssociativeMissRate(long long blocks) const {
+    if (references == 0) return 0.0;
+    long long misses = coldMisses;
+    for (size_t d = (size_t)blocks; d < fullDistances.size(); d++) misses += fullDistances[d];
+    return (double)misses / references;
+}
+
+StackDistanceProfile analyseStackDistances(const std::vector<uint64_t>& addresses, int s, int b, int maxWays) {
+    // Same address split as the simulated caches
+    Cache geometry(0, s, 1, b);
+    size_t numSets = (size_t)1 << s;
+
+    std::vector<unsigned int> setOf(addresses.size());
+    std::vector<size_t> perSet(numSets, 0);
+    for (size_t i = 0; i < addresses.size(); i++) {
+        setOf[i] = geometry.getSetIndexPublic(addresses[i]);
+        perSet[setOf[i]]++;
+    }
+
+    std::vector<DistanceStack> sets;
+    sets.reserve(numSets);
+    for (size_t set = 0; set < numSets; set++) sets.push_back(DistanceStack(perSet[set]));
+    DistanceStack full(addresses.size());
+
+    struct LastUse { size_t inSet; size_t inFull; };
+    std::unordered_map<uint64_t, LastUse> lastUse;
+    lastUse.reserve(addresses.size() / 4 + 16);
+
+    StackDistanceProfile profile;
+    profile.references = (long long)addresses.size();
+    profile.coldMisses = 0;
+    profile.setDistances.assign(maxWays + 1, 0);
+
+    for (size_t i = 0; i < addresses.size(); i++) {
+        uint64_t block = geometry.getTagPublic(addresses[i]); // block number
+        std::pair<std::unordered_map<uint64_t, LastUse>::iterator, bool> ins =
+            lastUse.insert(std::make_pair(block, LastUse()));
+        bool seen = !ins.second;
+        LastUse &last = ins.first->second;
+
+        long long setDistance = sets[setOf[i]].access(last.inSet, seen);
+        long long fullDistance = full.access(last.inFull, seen);
+        if (!seen) {
+            profile.coldMisses++;
+            continue;
+        }
+        profile.setDistances[std::min<long long>(setDistance, maxWays)]++;
+        if ((size_t)fullDistance >= profile.fullDistances.size()) {
+            profile.fullDistances.resize(fullDistance + 1, 0);
+        }
+        profile.fullDistances[fullDistance]++;
+    }
+    return profile;
+}
+
+void runStackDistanceAnalysis(const std::string& traceFilePrefix, int s, int b, int E,
+                              const std::string& outFileName, int numCores) {
+    const int maxWays = std::max(64, E);
+    std::vector<std::vector<TraceRecord> > traces = loadTraces(traceFilePrefix, numCores);
+
+    std::ofstream outFile;
+    if (!outFileName.empty()) {
+        outFile.open(outFileName);
+    }
+    std::ostream &out = (outFile.is_open() ? outFile : std::cout);
+
+    // Associativities reported at 2^s sets: powers of two, plus -E if it is not one
+    std::vector<int> ways;
+    for (int w = 1; w <= maxWays; w *= 2) ways.push_back(w);
+    if (E > 0 && (E & (E - 1)) != 0) {
+        ways.push_back(E);
+        std::sort(ways.begin(), ways.end());
+    }
+
+    out << "Stack Distance Analysis:" << std::endl;
+    out << "Trace Prefix: " << traceFilePrefix << std::endl;
+    out << "Set Index Bits: " << s << std::endl;
+    out << "Block Bits: " << b << std::endl;
+    out << "Private caches per core, coherence misses not included" << std::endl;
+    out << std::endl;
+
+    for (size_t core = 0; core < traces.size(); core++) {
+        std::vector<uint64_t> addresses(traces[core].size());
+        for (size_t i = 0; i < addresses.size(); i++) addresses[i] = traces[core][i].address;
+        StackDistanceProfile profile = analyseStackDistances(addresses, s, b, maxWays);
+
+        out << "Core " << core << " Miss-Rate Curves:" << std::endl;
+        out << "References: " << profile.references << std::endl;
+        out << "Cold Misses: " << profile.coldMisses << std::endl;
+        out << "Set-associative (" << (1 << s) << " sets):" << std::endl;
+        out << "E,cache_kb,miss_rate" << std::endl;
+        for (int w : ways) {
+            double kb = (double)((1LL << s) * w * (1LL << b)) / 1024.0;
+            out << w << "," << std::fixed << std::setprecision(2) << kb << ","
+                << std::setprecision(4) << 100.0 * profile.missRate(w) << std::endl;
+        }
+        out << "Fully-associative:" << std::endl;
+        out << "blocks,cache_kb,miss_rate" << std::endl;
+        long long maxBlocks = (long long)profile.fullDistances.size();
+        for (long long blocks = 1; ; blocks *= 2) {
+            double kb = (double)(blocks * (1LL << b)) / 1024.0;
+            out << blocks << "," << std::fixed << std::setprecision(2) << kb << ","
+                << std::setprecision(4) << 100.0 * profile.fullyAssociativeMissRate(blocks) << std::endl;
+            if (blocks >= maxBlocks) break; // only cold misses left
+        }
+        out << std::endl;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//
+// Single-pass LRU stack-distance (Mattson) analysis of each core's trace. For the 2^s sets of
+// the given block size it yields the miss rate of every associativity at once, and from one
+// global stack the miss rate of every fully-associative size. Each core is analysed as a
+// private cache on its own, so coherence misses are not included.
+//
+struct StackDistanceProfile {
+    long long references;
+    long long coldMisses;
+    std::vector<long long> setDistances;  // [d]: references with per-set distance d, last bucket = d >= cap
+    std::vector<long long> fullDistances; // [d]: references with fully-associative distance d
+
+    // Miss rate of an E-way cache with the analysed set count (E <= cap)
+    double missRate(int E) const;
+    // Miss rate of a fully-associative cache holding the given number of blocks
+    double fullyAssociativeMissRate(long long blocks) const;
+};
+
+StackDistanceProfile analyseStackDistances(const std::vector<uint64_t>& addresses, int s, int b, int maxWays);
+
+// Runs the analysis on every core of the trace and writes the miss-rate curves
+// (numCores <= 0 detects the core count from the trace files)
+void runStackDistanceAnalysis(const std::string& traceFilePrefix, int s, int b, int E,
+                              const std::string& outFileName, int numCores = 0);
+
+#endif // STACK_DISTANCE_H
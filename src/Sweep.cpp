@@ -0,0 +1,204 @@
+#include "Sweep.h"
+#include "CacheSimulator.h"
+#include "TraceReader.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+using namespace std;
+
+static std::vector<int> parseValues(const std::string& name, const std::vector<std::string>& items) {
+    std::vector<int> values;
+    for (const std::string& item : items) {
+        size_t dots = item.find("..");
+        if (dots == std::string::npos) {
+            values.push_back(std::stoi(item));
+            continue;
+        }
+        int lo = std::stoi(item.substr(0, dots));
+        int hi = std::stoi(item.substr(dots + 2));
+        if (hi < lo) {
+            throw std::invalid_argument("empty range " + item + " for " + name);
+        }
+        for (int v = lo; v <= hi; v++) {
+            values.push_back(v);
+        }
+    }
+    return values;
+}
+
+std::vector<SweepConfig> parseSweepSpec(const std::string& spec, int defaultS, int defaultE, int defaultB) {
+    // Split on commas; an item of the form key=value starts the list of a new parameter
+    std::vector<std::string> sItems, eItems, bItems;
+    std::vector<std::string>* current = nullptr;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq != std::string::npos) {
+            std::string key = item.substr(0, eq);
+            if (key == "s") current = &sItems;
+            else if (key == "E") current = &eItems;
+            else if (key == "b") current = &bItems;
+            else throw std::invalid_argument("unknown sweep parameter '" + key + "'");
+            item = item.substr(eq + 1);
+        }
+        if (!current || item.empty()) {
+            throw std::invalid_argument("malformed sweep spec: " + spec);
+        }
+        current->push_back(item);
+    }
+
+    std::vector<int> sValues = sItems.empty() ? std::vector<int>(1, defaultS) : parseValues("s", sItems);
+    std::vector<int> eValues = eItems.empty() ? std::vector<int>(1, defaultE) : parseValues("E", eItems);
+    std::vector<int> bValues = bItems.empty() ? std::vector<int>(1, defaultB) : parseValues("b", bItems);
+
+    std::vector<SweepConfig> configs;
+    for (int s : sValues) {
+        for (int E : eValues) {
+            for (int b : bValues) {
+                if (s <= 0 || E <= 0 || b <= 0 || s + b > 31) {
+                    throw std::invalid_argument("invalid sweep point s=" + std::to_string(s) +
+                                                " E=" + std::to_string(E) + " b=" + std::to_string(b));
+                }
+                SweepConfig config = { s, E, b };
+                configs.push_back(config);
+            }
+        }
+    }
+    return configs;
+}
+
+void runSweep(const std::string& traceFilePrefix, const std::vector<SweepConfig>& configs,
+              const std::string& outFileName, int numThreads, int numCores) {
+    // One decode pass; every simulator walks these arrays through its own ArrayTraceSource
+    const std::vector<std::vector<TraceRecord> > traces = loadTraces(traceFilePrefix, numCores);
+
+    std::vector<SimulationSummary> results(configs.size());
+    std::atomic<size_t> nextConfig(0);
+    std::mutex errorLock;
+    std::string firstError;
+
+    auto worker = [&]() {
+        size_t i;
+        while ((i = nextConfig.fetch_add(1)) < configs.size()) {
+            try {
+                std::vector<std::unique_ptr<TraceSource> > sources;
+                for (const std::vector<TraceRecord>& trace : traces) {
+                    sources.emplace_back(new ArrayTraceSource(trace));
+                }
+                CacheSimulator simulator(std::move(sources), configs[i].s, configs[i].E, configs[i].b, "");
+                simulator.simulate();
+                results[i] = simulator.summary();
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> guard(errorLock);
+                if (firstError.empty()) firstError = e.what();
+            }
+        }
+    };
+
+    if (numThreads < 1) numThreads = 1;
+    if ((size_t)numThreads > configs.size()) numThreads = (int)configs.size();
+    std::vector<std::thread> pool;
+    for (int t = 1; t < numThreads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker(); // the calling thread works too
+    for (std::thread& t : pool) {
+        t.join();
+    }
+    if (!firstError.empty()) {
+        throw std::runtime_error(firstError);
+    }
+
+    std::ofstream outFile;
+    if (!outFileName.empty()) {
+        outFile.open(outFileName);
+    }
+    std::ostream &out = (outFile.is_open() ? outFile : std::cout);
+
+    out << "s,E,b,cache_kb,instructions,misses,miss_rate,evictions,writebacks,invalidations,"
+        << "bus_transactions,bus_traffic_bytes,cycles,idle_cycles" << std::endl;
+    for (size_t i = 0; i < configs.size(); i++) {
+        const SweepConfig &c = configs[i];
+        const SimulationSummary &r = results[i];
+        double cacheKB = (double)((1LL << c.s) * c.E * (1LL << c.b)) / 1024.0;
+        double missRate = (r.instructions > 0) ? 100.0 * r.misses / r.instructions : 0.0;
+        out << c.s << "," << c.E << "," << c.b << "," << std::fixed << std::setprecision(2) << cacheKB << ","
+            << r.instructions << "," << r.misses << "," << missRate << "," << r.evictions << ","
+            << r.writebacks << "," << r.invalidations << "," << r.busTransactions << ","
+            << r.busTraffic << "," << r.cycles << "," << r.idleCycles << std::endl;
+    }
+}
+
+std::vector<int> parseValueList(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) {
+            throw std::invalid_argument("malformed list: " + list);
+        }
+        items.push_back(item);
+    }
+    return parseValues("list", items);
+}
+
+// Signed relative error in percent
+static double relativeError(long long value, long long reference) {
+    if (reference == 0) return (value == 0) ? 0.0 : 100.0;
+    return 100.0 * (double)(value - reference) / (double)reference;
+}
+
+void runQuantumStudy(const std::string& traceFilePrefix, int s, int E, int b, const std::vector<int>& quanta,
+                     int numThreads, const std::string& outFileName, int numCores) {
+    const std::vector<std::vector<TraceRecord> > traces = loadTraces(traceFilePrefix, numCores);
+
+    // quantum 0 runs the serial event-driven engine
+    auto run = [&](int quantum, double& wallMs) {
+        std::vector<std::unique_ptr<TraceSource> > sources;
+        for (const std::vector<TraceRecord>& trace : traces) {
+            sources.emplace_back(new ArrayTraceSource(trace));
+        }
+        CacheSimulator simulator(std::move(sources), s, E, b, "");
+        if (quantum > 0) {
+            simulator.setParallel(numThreads, quantum);
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        simulator.simulate();
+        wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return simulator.summary();
+    };
+
+    double serialMs;
+    const SimulationSummary serial = run(0, serialMs);
+
+    std::ofstream outFile;
+    if (!outFileName.empty()) {
+        outFile.open(outFileName);
+    }
+    std::ostream &out = (outFile.is_open() ? outFile : std::cout);
+
+    out << "quantum,threads,wall_ms,speedup,cycles,cycles_err_pct,misses,misses_err_pct,idle_cycles,"
+        << "idle_err_pct,bus_transactions,bus_transactions_err_pct,invalidations,invalidations_err_pct" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    auto row = [&](int quantum, int threads, double wallMs, const SimulationSummary& r) {
+        out << quantum << "," << threads << "," << wallMs << "," << serialMs / std::max(wallMs, 1e-3) << ","
+            << r.cycles << "," << relativeError(r.cycles, serial.cycles) << ","
+            << r.misses << "," << relativeError(r.misses, serial.misses) << ","
+            << r.idleCycles << "," << relativeError(r.idleCycles, serial.idleCycles) << ","
+            << r.busTransactions << "," << relativeError(r.busTransactions, serial.busTransactions) << ","
+            << r.invalidations << "," << relativeError(r.invalidations, serial.invalidations) << std::endl;
+    };
+    row(0, 1, serialMs, serial);
+    for (int quantum : quanta) {
+        double wallMs;
+        SimulationSummary r = run(quantum, wallMs);
+        row(quantum, numThreads, wallMs, r);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <string>
+#include <vector>
+
+// One cache geometry of a design-space sweep
+struct SweepConfig {
+    int s;
+    int E;
+    int b;
+};
+
+// Parses a sweep spec such as "s=4..8,E=1,2,4,8,b=5,6" into the cross product of its values.
+// A parameter missing from the spec takes the given default (0 = not set, which is an error).
+std::vector<SweepConfig> parseSweepSpec(const std::string& spec, int defaultS, int defaultE, int defaultB);
+
+// Decodes the traces once, simulates every configuration on a pool of worker threads sharing
+// the decoded records read-only, and writes one CSV row per configuration (stdout if outFileName is empty).
+// numCores <= 0 detects the core count from the trace files.
+void runSweep(const std::string& traceFilePrefix, const std::vector<SweepConfig>& configs,
+              const std::string& outFileName, int numThreads, int numCores = 0);
+
+// Parses a list of values such as "100,1000..1003,10000"
+std::vector<int> parseValueList(const std::string& list);
+
+// Accuracy of the parallel engine: simulates the traces once with the serial engine and once per
+// quantum with the parallel one on numThreads threads, and writes a CSV of the wall-clock time
+// and of each total's relative error against the serial run
+void runQuantumStudy(const std::string& traceFilePrefix, int s, int E, int b, const std::vector<int>& quanta,
+                     int numThreads, const std::string& outFileName, int numCores = 0);
+
+#endif // SWEEP_H
@@ -0,0 +1,330 @@
+#include "SyntheticTrace.h"
+#include <stdexcept>
+#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+static const size_t CHUNK_RECORDS = 4096;
+static const uint64_t LINE_BYTES = 64;
+static const uint64_t WORDS_PER_LINE = LINE_BYTES / 4;
+static const uint64_t SHARED_BASE = 1ULL << 47;
+static const uint64_t REGION_LIMIT = 1ULL << 47; // bytes below, and above, SHARED_BASE
+// Prime multiplier scattering the Zipf ranks over the lines; a footprint of fewer lines keeps
+// the scatter a bijection and its product within 64 bits
+static const uint64_t ZIPF_SCATTER = 2654435761ULL;
+
+// Lock ping-pong iteration: spin reads, acquire, critical section, release, private work
+static const uint64_t LOCK_SPINS = 2;
+static const uint64_t LOCK_CRITICAL = 8;
+static const uint64_t LOCK_PRIVATE = 4;
+static const uint64_t LOCK_ITERATION = LOCK_SPINS + 1 + LOCK_CRITICAL + 1 + LOCK_PRIVATE;
+
+static const struct {
+    const char* name;
+    SyntheticPattern pattern;
+} PATTERNS[] = {
+    { "sequential", SYNTHETIC_SEQUENTIAL },
+    { "uniform", SYNTHETIC_UNIFORM },
+    { "zipf", SYNTHETIC_ZIPF },
+    { "producer-consumer", SYNTHETIC_PRODUCER_CONSUMER },
+    { "migratory", SYNTHETIC_MIGRATORY },
+    { "false-sharing", SYNTHETIC_FALSE_SHARING },
+    { "lock-pingpong", SYNTHETIC_LOCK_PINGPONG }
+};
+
+bool isSyntheticTrace(const string& prefix) {
+    return prefix.compare(0, strlen(SYNTHETIC_TRACE_PREFIX), SYNTHETIC_TRACE_PREFIX) == 0;
+}
+
+const char* syntheticPatternName(SyntheticPattern pattern) {
+    for (size_t i = 0; i < sizeof(PATTERNS) / sizeof(PATTERNS[0]); i++) {
+        if (PATTERNS[i].pattern == pattern) return PATTERNS[i].name;
+    }
+    return "unknown";
+}
+
+// Non-negative count with an optional K, M or G (binary) suffix
+static uint64_t parseCount(const string& key, const string& value) {
+    char* end = nullptr;
+    unsigned long long n = strtoull(value.c_str(), &end, 10);
+    if (end == value.c_str() || value[0] == '-') {
+        throw invalid_argument("invalid synthetic trace " + key + ": " + value);
+    }
+    string suffix(end);
+    if (suffix == "K" || suffix == "k") n <<= 10;
+    else if (suffix == "M" || suffix == "m") n <<= 20;
+    else if (suffix == "G" || suffix == "g") n <<= 30;
+    else if (!suffix.empty()) throw invalid_argument("invalid synthetic trace " + key + ": " + value);
+    return n;
+}
+
+// Private regions (one per core, or one buffer per producer/consumer pair) must fit below
+// REGION_LIMIT together
+static uint64_t regionsNeeded(const SyntheticSpec& spec) {
+    switch (spec.pattern) {
+        case SYNTHETIC_SEQUENTIAL:
+        case SYNTHETIC_UNIFORM:
+        case SYNTHETIC_ZIPF:
+        case SYNTHETIC_LOCK_PINGPONG:
+            return (uint64_t)spec.cores;
+        case SYNTHETIC_PRODUCER_CONSUMER:
+            return ((uint64_t)spec.cores + 1) / 2;
+        default:
+            return 1;
+    }
+}
+
+SyntheticSpec parseSyntheticSpec(const string& prefix) {
+    if (!isSyntheticTrace(prefix)) {
+        throw invalid_argument("not a synthetic trace: " + prefix);
+    }
+    SyntheticSpec spec;
+    spec.pattern = SYNTHETIC_SEQUENTIAL;
+    spec.cores = 4;
+    spec.refsPerCore = 1000000;
+    spec.seed = 1;
+    spec.footprint = 0; // pattern default
+    spec.writePercent = 30;
+    spec.alpha = 0.99;
+
+    stringstream ss(prefix.substr(strlen(SYNTHETIC_TRACE_PREFIX)));
+    string item;
+    bool first = true;
+    while (getline(ss, item, ',')) {
+        if (first) {
+            first = false;
+            size_t i = 0;
+            while (i < sizeof(PATTERNS) / sizeof(PATTERNS[0]) && item != PATTERNS[i].name) i++;
+            if (i == sizeof(PATTERNS) / sizeof(PATTERNS[0])) {
+                throw invalid_argument("unknown synthetic pattern '" + item + "'");
+            }
+            spec.pattern = PATTERNS[i].pattern;
+            continue;
+        }
+        size_t eq = item.find('=');
+        if (eq == string::npos) {
+            throw invalid_argument("malformed synthetic trace parameter: " + item);
+        }
+        string key = item.substr(0, eq);
+        string value = item.substr(eq + 1);
+        if (key == "cores") spec.cores = (int)parseCount(key, value);
+        else if (key == "refs") spec.refsPerCore = parseCount(key, value);
+        else if (key == "seed") spec.seed = parseCount(key, value);
+        else if (key == "footprint") spec.footprint = parseCount(key, value);
+        else if (key == "writes") spec.writePercent = (int)parseCount(key, value);
+        else if (key == "alpha") spec.alpha = atof(value.c_str());
+        else throw invalid_argument("unknown synthetic trace parameter '" + key + "'");
+    }
+    if (first) {
+        throw invalid_argument("synthetic trace needs a pattern: " + prefix);
+    }
+    if (spec.cores <= 0 || spec.writePercent > 100 || !(spec.alpha > 0)) {
+        throw invalid_argument("invalid synthetic trace parameters: " + prefix);
+    }
+    if (spec.footprint == 0) {
+        bool sharedPattern = spec.pattern != SYNTHETIC_SEQUENTIAL && spec.pattern != SYNTHETIC_UNIFORM &&
+                             spec.pattern != SYNTHETIC_ZIPF;
+        spec.footprint = sharedPattern ? 4 << 10 : 1 << 20;
+    }
+    spec.footprint -= spec.footprint % LINE_BYTES;
+    if (spec.footprint == 0) {
+        throw invalid_argument("synthetic trace footprint must be at least 64 bytes");
+    }
+    if (spec.pattern == SYNTHETIC_ZIPF && spec.footprint / LINE_BYTES >= ZIPF_SCATTER) {
+        throw invalid_argument("zipf footprint must be below " + to_string(ZIPF_SCATTER) + " lines of " +
+                               to_string(LINE_BYTES) + " bytes: " + prefix);
+    }
+    return spec;
+}
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+//
+// Zipf(alpha) over ranks 1..N by rejection-inversion (Hormann and Derflinger): invert the
+// integral of the density, round, and accept unless the point falls in the rounding gap.
+// The expected number of draws per sample is close to one.
+//
+static double helper1(double x) {
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+static double helper2(double x) {
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+static double zipfH(double alpha, double x) {
+    return exp(-alpha * log(x));
+}
+
+static double zipfIntegral(double alpha, double x) {
+    double logX = log(x);
+    return helper2((1 - alpha) * logX) * logX;
+}
+
+static double zipfIntegralInverse(double alpha, double x) {
+    double t = x * (1 - alpha);
+    if (t < -1) t = -1;
+    return exp(helper1(t) * x);
+}
+
+SyntheticTraceSource::SyntheticTraceSource(const SyntheticSpec& spec, int core)
+    : spec(spec), core(core), index(0), buffer(CHUNK_RECORDS) {
+    rng = splitmix64(spec.seed ^ splitmix64((uint64_t)core + 1));
+    if (rng == 0) rng = 1;
+    lines = spec.footprint / LINE_BYTES;
+    uint64_t region = (spec.pattern == SYNTHETIC_PRODUCER_CONSUMER) ? (uint64_t)core / 2 : (uint64_t)core;
+    privateBase = region * spec.footprint;
+    sharedBase = SHARED_BASE + ((spec.pattern == SYNTHETIC_PRODUCER_CONSUMER) ? privateBase : 0);
+
+    zipfIntegralX1 = zipfIntegral(spec.alpha, 1.5) - 1;
+    zipfIntegralN = zipfIntegral(spec.alpha, (double)lines + 0.5);
+    zipfShift = 2 - zipfIntegralInverse(spec.alpha, zipfIntegral(spec.alpha, 2.5) - zipfH(spec.alpha, 2));
+
+    lastChunk.kind = TRACE_POSITION_SYNTHETIC;
+    lastChunk.reserved = 0;
+    lastChunk.offset = 0;
+    lastChunk.state = rng;
+    lastChunk.remaining = 0;
+}
+
+// xorshift64*
+uint64_t SyntheticTraceSource::random() {
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545f4914f6cdd1dULL;
+}
+
+double SyntheticTraceSource::uniform01() {
+    return (double)(random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Rank 1..lines, rank 1 the most popular
+uint64_t SyntheticTraceSource::zipfRank() {
+    for (;;) {
+        double u = zipfIntegralN + uniform01() * (zipfIntegralX1 - zipfIntegralN);
+        double x = zipfIntegralInverse(spec.alpha, u);
+        double k = floor(x + 0.5);
+        if (k < 1) k = 1;
+        else if (k > (double)lines) k = (double)lines;
+        if (k - x <= zipfShift || u >= zipfIntegral(spec.alpha, k + 0.5) - zipfH(spec.alpha, k)) {
+            return (uint64_t)k;
+        }
+    }
+}
+
+TraceRecord SyntheticTraceSource::generate() {
+    TraceRecord record;
+    uint64_t offset = 0; // byte offset into the region the record addresses
+    bool shared = false;
+    bool write = false;
+    uint64_t i = index;
+    switch (spec.pattern) {
+        case SYNTHETIC_SEQUENTIAL:
+            offset = (i * 4) % spec.footprint;
+            write = random() % 100 < (uint64_t)spec.writePercent;
+            break;
+        case SYNTHETIC_UNIFORM:
+            offset = (random() % (spec.footprint / 4)) * 4;
+            write = random() % 100 < (uint64_t)spec.writePercent;
+            break;
+        case SYNTHETIC_ZIPF:
+            // Scatter the ranks over the region with a multiplicative permutation (the
+            // multiplier is prime and larger than the line count, which parseSyntheticSpec checks)
+            offset = (((zipfRank() - 1) * ZIPF_SCATTER) % lines) * LINE_BYTES + (random() % WORDS_PER_LINE) * 4;
+            write = random() % 100 < (uint64_t)spec.writePercent;
+            break;
+        case SYNTHETIC_PRODUCER_CONSUMER:
+            // The consumer reads half a buffer behind the producer's write position
+            shared = true;
+            if (core % 2 == 0) {
+                offset = (i * 4) % spec.footprint;
+                write = true;
+            } else {
+                offset = (i * 4 + spec.footprint / 2) % spec.footprint;
+            }
+            break;
+        case SYNTHETIC_MIGRATORY: {
+            // Read then write one word of object (step + core): what core c + 1 touched at one
+            // step, core c touches at the next
+            uint64_t step = i / 2;
+            shared = true;
+            offset = ((step + core) % lines) * LINE_BYTES + ((step * 7) % WORDS_PER_LINE) * 4;
+            write = (i % 2) == 1;
+            break;
+        }
+        case SYNTHETIC_FALSE_SHARING:
+            shared = true;
+            offset = (i % lines) * LINE_BYTES + ((uint64_t)core % WORDS_PER_LINE) * 4;
+            write = random() % 100 < (uint64_t)spec.writePercent;
+            break;
+        case SYNTHETIC_LOCK_PINGPONG: {
+            // Line 0 of the shared region is the lock; the rest is the data it protects
+            uint64_t phase = i % LOCK_ITERATION;
+            if (phase < LOCK_SPINS) {
+                shared = true;
+            } else if (phase == LOCK_SPINS || phase == LOCK_SPINS + 1 + LOCK_CRITICAL) {
+                shared = true;
+                write = true;
+            } else if (phase < LOCK_SPINS + 1 + LOCK_CRITICAL) {
+                shared = true;
+                uint64_t dataWords = (spec.footprint - LINE_BYTES) / 4;
+                offset = dataWords > 0 ? LINE_BYTES + (random() % dataWords) * 4 : 0;
+                write = random() % 100 < (uint64_t)spec.writePercent;
+            } else {
+                offset = (random() % (spec.footprint / 4)) * 4;
+                write = random() % 100 < (uint64_t)spec.writePercent;
+            }
+            break;
+        }
+    }
+    record.address = (shared ? sharedBase : privateBase) + offset;
+    record.op = write ? WRITE : READ;
+    index++;
+    return record;
+}
+
+size_t SyntheticTraceSource::nextChunk(const TraceRecord*& chunk) {
+    lastChunk.offset = index;
+    lastChunk.state = rng;
+    uint64_t left = spec.refsPerCore - index;
+    size_t n = left < CHUNK_RECORDS ? (size_t)left : CHUNK_RECORDS;
+    TraceRecord* out = buffer.data();
+    for (size_t k = 0; k < n; k++) {
+        out[k] = generate();
+    }
+    chunk = out;
+    return n;
+}
+
+// Records generated so far and the generator state at that point
+bool SyntheticTraceSource::seek(const TracePosition& position) {
+    if (position.kind != TRACE_POSITION_SYNTHETIC) return false;
+    if (position.offset > spec.refsPerCore) {
+        throw runtime_error("synthetic trace position past the end of the core's stream");
+    }
+    index = position.offset;
+    rng = position.state;
+    return true;
+}
+
+vector<unique_ptr<TraceSource> > openSyntheticTrace(const string& prefix, int numCores) {
+    SyntheticSpec spec = parseSyntheticSpec(prefix);
+    if (numCores > 0) spec.cores = numCores;
+    if (regionsNeeded(spec) * spec.footprint > REGION_LIMIT) {
+        throw invalid_argument("synthetic trace footprint too large for " + to_string(spec.cores) +
+                               " cores in a 48-bit address space: " + prefix);
+    }
+    vector<unique_ptr<TraceSource> > sources;
+    for (int i = 0; i < spec.cores; i++) {
+        sources.emplace_back(new SyntheticTraceSource(spec, i));
+    }
+    return sources;
+}
@@ -0,0 +1,87 @@
+#ifndef SYNTHETIC_TRACE_H
+#define SYNTHETIC_TRACE_H
+
+#include "TraceReader.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// -t prefix that selects a generated workload instead of trace files
+const char* const SYNTHETIC_TRACE_PREFIX = "synthetic:";
+
+enum SyntheticPattern {
+    SYNTHETIC_SEQUENTIAL,        // each core streams through its private region
+    SYNTHETIC_UNIFORM,           // uniform random words of the private region
+    SYNTHETIC_ZIPF,              // Zipf-popular 64-byte lines of the private region
+    SYNTHETIC_PRODUCER_CONSUMER, // even cores write a shared buffer, the next odd core reads it behind them
+    SYNTHETIC_MIGRATORY,         // read-modify-write of shared objects that move from core to core
+    SYNTHETIC_FALSE_SHARING,     // every core uses its own word of the same shared lines
+    SYNTHETIC_LOCK_PINGPONG      // spin, acquire and release of one shared lock around private work
+};
+
+//
+// Generated workload, written "synthetic:<pattern>[,key=value...]" with the keys
+//   cores=<n>       cores (default 4)
+//   refs=<n>        references per core (default 1000000; K/M/G suffixes)
+//   seed=<n>        random seed (default 1)
+//   footprint=<n>   bytes per private region or shared structure (K/M/G suffixes; default 1M for
+//                   the private patterns, 4K for the sharing ones so the shared lines stay cached;
+//                   zipf takes fewer than 2654435761 lines, about 158 GB)
+//   writes=<pct>    write percentage where the pattern leaves it free (default 30)
+//   alpha=<a>       Zipf exponent (default 0.99)
+// Private regions lie below 2^47 and shared structures above, so the two never alias and the
+// sharing patterns exercise the upper bits of 48-bit virtual addresses. A Zipf
+// sample is drawn by rejection-inversion, so footprints of any size cost no memory.
+//
+struct SyntheticSpec {
+    SyntheticPattern pattern;
+    int cores;
+    uint64_t refsPerCore;
+    uint64_t seed;
+    uint64_t footprint;
+    int writePercent;
+    double alpha;
+};
+
+bool isSyntheticTrace(const std::string& prefix);
+SyntheticSpec parseSyntheticSpec(const std::string& prefix);
+const char* syntheticPatternName(SyntheticPattern pattern);
+
+//
+// One core's generated reference stream. Records are produced a chunk at a time, so memory stays
+// constant however many references are requested. Each record depends only on the seed, the
+// core and its index, so a position is (index, generator state) and the source can seek.
+//
+class SyntheticTraceSource : public TraceSource {
+private:
+    SyntheticSpec spec;
+    int core;
+    uint64_t index;   // records generated so far
+    uint64_t rng;     // xorshift64* state
+    uint64_t privateBase;
+    uint64_t sharedBase;
+    uint64_t lines;   // 64-byte lines in the footprint
+    // Zipf rejection-inversion sampler constants (no per-line table)
+    double zipfIntegralX1;
+    double zipfIntegralN;
+    double zipfShift;
+    std::vector<TraceRecord> buffer;
+    TracePosition lastChunk;
+
+    uint64_t random();
+    double uniform01();
+    uint64_t zipfRank();
+    TraceRecord generate();
+
+public:
+    SyntheticTraceSource(const SyntheticSpec& spec, int core);
+    size_t nextChunk(const TraceRecord*& chunk);
+    bool chunkStart(TracePosition& position) const { position = lastChunk; return true; }
+    bool seek(const TracePosition& position);
+};
+
+// One generator per core (numCores > 0 overrides the spec's cores=)
+std::vector<std::unique_ptr<TraceSource> > openSyntheticTrace(const std::string& prefix, int numCores = 0);
+
+#endif // SYNTHETIC_TRACE_H
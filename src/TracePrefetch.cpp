@@ -0,0 +1,156 @@
+#include "TracePrefetch.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <algorithm>
+using namespace std;
+
+// One core's trace on its way from a reader thread to the simulator
+struct PrefetchChannel {
+    // Reader side
+    std::unique_ptr<TraceSource> source;
+    const TraceRecord* pending; // decoded records not yet in the ring
+    size_t pendingLen;
+    std::string error;          // decode failure, published through `finished`
+    bool waitingForSpace;       // the ring was found full and has not accepted records since
+
+    SpscRing<TraceRecord> ring;
+    std::atomic<bool> finished; // the last record has been committed (or decoding failed)
+    std::atomic<uint64_t> ringFull;
+
+    PrefetchChannel(std::unique_ptr<TraceSource> source, size_t ringRecords)
+        : source(std::move(source)), pending(nullptr), pendingLen(0), waitingForSpace(false), ring(ringRecords),
+          finished(false), ringFull(0) {}
+};
+
+// Shared by the returned sources; the last one to go stops and joins the readers
+struct PrefetchState {
+    std::vector<std::unique_ptr<PrefetchChannel> > channels;
+    std::vector<std::thread> readers;
+    std::atomic<bool> stopping;
+
+    PrefetchState() : stopping(false) {}
+    ~PrefetchState() {
+        stopping.store(true);
+        for (std::thread& t : readers) {
+            t.join();
+        }
+    }
+};
+
+// Moves as many decoded records as fit into the channel's ring. Returns whether anything changed.
+static bool fillChannel(PrefetchChannel& c) {
+    bool moved = false;
+    try {
+        while (true) {
+            if (c.pendingLen == 0) {
+                c.pendingLen = c.source->nextChunk(c.pending);
+                if (c.pendingLen == 0) {
+                    c.source.reset(); // release the file as soon as it is done
+                    c.finished.store(true, std::memory_order_release);
+                    return true;
+                }
+            }
+            TraceRecord* span;
+            size_t n = c.ring.writable(span);
+            if (n == 0) {
+                if (!c.waitingForSpace) {
+                    c.ringFull.fetch_add(1, std::memory_order_relaxed); // counted once per stall
+                    c.waitingForSpace = true;
+                }
+                return moved;
+            }
+            c.waitingForSpace = false;
+            n = std::min(n, c.pendingLen);
+            std::copy(c.pending, c.pending + n, span);
+            c.ring.commit(n);
+            c.pending += n;
+            c.pendingLen -= n;
+            moved = true;
+        }
+    } catch (const std::exception& e) {
+        c.error = e.what();
+        c.finished.store(true, std::memory_order_release);
+        return true;
+    }
+}
+
+// Reader thread: round-robin over channels first, first + stride, ... until all are finished
+static void readChannels(PrefetchState* state, size_t first, size_t stride) {
+    while (!state->stopping.load(std::memory_order_relaxed)) {
+        bool active = false;
+        bool progress = false;
+        for (size_t i = first; i < state->channels.size(); i += stride) {
+            PrefetchChannel& c = *state->channels[i];
+            if (c.finished.load(std::memory_order_relaxed)) continue;
+            active = true;
+            progress |= fillChannel(c);
+        }
+        if (!active) break;
+        if (!progress) {
+            // Every ring is full: give the simulator time to drain them
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+// Simulator side of one channel
+class PrefetchTraceSource : public TraceSource {
+private:
+    std::shared_ptr<PrefetchState> state;
+    PrefetchChannel* channel;
+    size_t held;        // length of the span handed out by the last nextChunk
+    uint64_t ringEmpty;
+
+public:
+    PrefetchTraceSource(std::shared_ptr<PrefetchState> state, PrefetchChannel* channel)
+        : state(state), channel(channel), held(0), ringEmpty(0) {}
+
+    size_t nextChunk(const TraceRecord*& chunk) {
+        if (held > 0) {
+            channel->ring.release(held);
+            held = 0;
+        }
+        size_t n;
+        for (int spins = 0; (n = channel->ring.readable(chunk)) == 0; spins++) {
+            if (channel->finished.load(std::memory_order_acquire)) {
+                // Records committed before `finished` was set are visible now
+                if ((n = channel->ring.readable(chunk)) > 0) break;
+                if (!channel->error.empty()) {
+                    throw std::runtime_error(channel->error);
+                }
+                return 0;
+            }
+            if (spins == 0) ringEmpty++; // counted once per stall
+            if (spins > 100) std::this_thread::yield();
+        }
+        held = n;
+        return n;
+    }
+
+    bool stallCounters(TraceStallCounters& counters) const {
+        counters.ringFull = channel->ringFull.load(std::memory_order_relaxed);
+        counters.ringEmpty = ringEmpty;
+        return true;
+    }
+};
+
+std::vector<std::unique_ptr<TraceSource> > prefetchTraceSources(std::vector<std::unique_ptr<TraceSource> > sources,
+                                                                int numThreads, size_t ringRecords) {
+    std::shared_ptr<PrefetchState> state(new PrefetchState());
+    for (std::unique_ptr<TraceSource>& source : sources) {
+        state->channels.emplace_back(new PrefetchChannel(std::move(source), ringRecords));
+    }
+    size_t stride = std::max<size_t>(1, std::min<size_t>(numThreads, state->channels.size()));
+    for (size_t t = 0; t < stride && t < state->channels.size(); t++) {
+        state->readers.emplace_back(readChannels, state.get(), t, stride);
+    }
+
+    std::vector<std::unique_ptr<TraceSource> > prefetched;
+    for (std::unique_ptr<PrefetchChannel>& channel : state->channels) {
+        prefetched.emplace_back(new PrefetchTraceSource(state, channel.get()));
+    }
+    return prefetched;
+}
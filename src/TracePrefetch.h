@@ -0,0 +1,22 @@
+#ifndef TRACE_PREFETCH_H
+#define TRACE_PREFETCH_H
+
+#include "TraceReader.h"
+#include <vector>
+#include <memory>
+
+// Records buffered per core between a reader thread and the simulator
+const size_t PREFETCH_RING_RECORDS = 1 << 16;
+
+//
+// Asynchronous trace reading. Reader threads pull records from the given sources (file I/O and
+// decoding) and push them into one bounded single-producer/single-consumer ring per core; the
+// returned sources hand the simulator spans of those rings, so decoding overlaps simulation and
+// memory stays bounded whatever the trace length. Each reader thread serves a fixed subset of the
+// cores. The readers stop when every returned source has been destroyed.
+//
+std::vector<std::unique_ptr<TraceSource> > prefetchTraceSources(std::vector<std::unique_ptr<TraceSource> > sources,
+                                                                int numThreads,
+                                                                size_t ringRecords = PREFETCH_RING_RECORDS);
+
+#endif // TRACE_PREFETCH_H
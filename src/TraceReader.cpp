@@ -0,0 +1,356 @@
+#include "TraceReader.h"
+#include "SyntheticTrace.h"
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+static const size_t CHUNK_RECORDS = 4096;
+
+MappedFile::MappedFile(const std::string& fileName) : base(nullptr), length(0) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open file: " + fileName);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("cannot stat file: " + fileName);
+    }
+    length = (size_t)st.st_size;
+    if (length > 0) {
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("cannot map file: " + fileName);
+        }
+        madvise(p, length, MADV_SEQUENTIAL);
+        base = static_cast<const char*>(p);
+    }
+    close(fd); // the mapping keeps its own reference
+}
+
+MappedFile::~MappedFile() {
+    if (base) {
+        munmap(const_cast<char*>(base), length);
+    }
+}
+
+//
+// Text traces
+//
+static signed char hexValue[256];
+
+static bool initHexTable() {
+    for (int c = 0; c < 256; c++) hexValue[c] = -1;
+    for (int c = '0'; c <= '9'; c++) hexValue[c] = (signed char)(c - '0');
+    for (int c = 'a'; c <= 'f'; c++) hexValue[c] = (signed char)(c - 'a' + 10);
+    for (int c = 'A'; c <= 'F'; c++) hexValue[c] = (signed char)(c - 'A' + 10);
+    return true;
+}
+static const bool hexTableReady = initHexTable();
+
+static void badLine(const std::string& fileName, size_t lineNo, const char* what) {
+    throw std::runtime_error(std::string(what) + " at " + fileName + ":" + std::to_string(lineNo));
+}
+
+// Decodes up to maxRecords lines from [cursor, e) into out, advancing cursor and lineNo
+static size_t parseTextRecords(const unsigned char*& cursor, const unsigned char* e, TraceRecord* out,
+                               size_t maxRecords, size_t& lineNo, const std::string& fileName) {
+    const unsigned char* p = cursor;
+    size_t n = 0;
+    while (p < e && n < maxRecords) {
+        lineNo++;
+        while (p < e && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p == e) break;
+        if (*p == '\n') { p++; continue; } // blank line
+
+        TraceRecord record;
+        if (*p == 'R') record.op = READ;
+        else if (*p == 'W') record.op = WRITE;
+        else badLine(fileName, lineNo, "bad operation");
+        p++;
+        while (p < e && (*p == ' ' || *p == '\t')) p++;
+        if (e - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+
+        uint64_t address = 0;
+        const unsigned char* digits = p;
+        int v;
+        while (p < e && (v = hexValue[*p]) >= 0) {
+            if (address >> 60) badLine(fileName, lineNo, "address wider than 64 bits");
+            address = (address << 4) | (uint64_t)v;
+            p++;
+        }
+        if (p == digits) badLine(fileName, lineNo, "missing address");
+        record.address = address;
+        out[n++] = record;
+
+        while (p < e && *p != '\n') p++; // ignore anything after the address
+        if (p < e) p++;
+    }
+    cursor = p;
+    return n;
+}
+
+TextTraceSource::TextTraceSource(const std::string& fileName)
+    : file(fileName), fileName(fileName), lineNo(0), buffer(CHUNK_RECORDS) {
+    (void)hexTableReady;
+    cursor = reinterpret_cast<const unsigned char*>(file.data());
+    end = cursor + file.size();
+    lastChunk.kind = TRACE_POSITION_TEXT;
+    lastChunk.reserved = 0;
+    lastChunk.offset = 0;
+    lastChunk.state = 0;
+    lastChunk.remaining = 0;
+}
+
+size_t TextTraceSource::nextChunk(const TraceRecord*& chunk) {
+    lastChunk.offset = (uint64_t)(cursor - reinterpret_cast<const unsigned char*>(file.data()));
+    lastChunk.state = lineNo;
+    chunk = buffer.data();
+    return parseTextRecords(cursor, end, buffer.data(), buffer.size(), lineNo, fileName);
+}
+
+// Offsets and line number are relative to the start of the file
+bool TextTraceSource::seek(const TracePosition& position) {
+    if (position.kind != TRACE_POSITION_TEXT) return false;
+    if (position.offset > file.size()) {
+        throw std::runtime_error("trace position past the end of " + fileName);
+    }
+    cursor = reinterpret_cast<const unsigned char*>(file.data()) + position.offset;
+    lineNo = (size_t)position.state;
+    return true;
+}
+
+// The only chunk is the whole array, decoded from offset 0
+bool ArrayTraceSource::chunkStart(TracePosition& position) const {
+    position.kind = TRACE_POSITION_ARRAY;
+    position.reserved = 0;
+    position.offset = 0;
+    position.state = 0;
+    position.remaining = 0;
+    return true;
+}
+
+bool ArrayTraceSource::seek(const TracePosition& position) {
+    if (position.kind != TRACE_POSITION_ARRAY) return false;
+    consumed = false;
+    return true;
+}
+
+size_t ArrayTraceSource::nextChunk(const TraceRecord*& chunk) {
+    if (consumed) return 0;
+    consumed = true;
+    chunk = records->data();
+    return records->size();
+}
+
+//
+// Binary traces
+//
+static inline uint64_t zigzagEncode(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t zigzagDecode(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+BinaryTraceSource::BinaryTraceSource(std::shared_ptr<MappedFile> file, const BinaryTraceCoreEntry& entry)
+    : file(file), remaining(entry.recordCount), prevAddress(0) {
+    // Written without the sum, which a corrupt entry can overflow
+    if (entry.byteOffset > file->size() || entry.byteLength > file->size() - entry.byteOffset) {
+        throw std::runtime_error("truncated binary trace");
+    }
+    cursor = reinterpret_cast<const unsigned char*>(file->data()) + entry.byteOffset;
+    end = cursor + entry.byteLength;
+    buffer.resize(CHUNK_RECORDS);
+    lastChunk.kind = TRACE_POSITION_BINARY;
+    lastChunk.reserved = 0;
+    lastChunk.offset = entry.byteOffset;
+    lastChunk.state = 0;
+    lastChunk.remaining = remaining;
+}
+
+// Offset from the start of the file, previous address and records left at that point
+bool BinaryTraceSource::seek(const TracePosition& position) {
+    if (position.kind != TRACE_POSITION_BINARY) return false;
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(file->data());
+    if (position.offset > (uint64_t)(end - base)) {
+        throw std::runtime_error("binary trace position past the end of the core's stream");
+    }
+    cursor = base + position.offset;
+    prevAddress = position.state;
+    remaining = position.remaining;
+    return true;
+}
+
+size_t BinaryTraceSource::nextChunk(const TraceRecord*& chunk) {
+    lastChunk.offset = (uint64_t)(cursor - reinterpret_cast<const unsigned char*>(file->data()));
+    lastChunk.state = prevAddress;
+    lastChunk.remaining = remaining;
+    size_t n = 0;
+    const unsigned char* p = cursor;
+    uint64_t prev = prevAddress;
+    TraceRecord* out = buffer.data();
+    while (n < CHUNK_RECORDS && remaining > 0) {
+        uint64_t v = 0;
+        int shift = 0;
+        unsigned char byte;
+        do {
+            if (p == end) {
+                throw std::runtime_error("truncated binary trace record");
+            }
+            if (shift > 63) { // a 64-bit value takes at most 10 bytes
+                throw std::runtime_error("corrupt binary trace record");
+            }
+            byte = *p++;
+            v |= (uint64_t)(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        prev += (uint64_t)zigzagDecode(v >> 1);
+        out[n].address = prev;
+        out[n].op = (v & 1) ? WRITE : READ;
+        n++;
+        remaining--;
+    }
+    cursor = p;
+    prevAddress = prev;
+    chunk = out;
+    return n;
+}
+
+void BinaryTraceEncoder::append(const TraceRecord& record) {
+    int64_t delta = (int64_t)((uint64_t)record.address - prevAddress);
+    uint64_t v = (zigzagEncode(delta) << 1) | (record.op == WRITE ? 1 : 0);
+    while (v >= 0x80) {
+        bytes.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    bytes.push_back((unsigned char)v);
+    prevAddress = record.address;
+    count++;
+}
+
+void writeBinaryTrace(const std::string& fileName, const std::vector<BinaryTraceEncoder>& cores) {
+    std::ofstream out(fileName, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("cannot create binary trace: " + fileName);
+    }
+    BinaryTraceHeader header;
+    memcpy(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic));
+    header.version = BINARY_TRACE_VERSION;
+    header.numCores = (uint32_t)cores.size();
+    header.reserved = 0;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    uint64_t offset = sizeof(header) + cores.size() * sizeof(BinaryTraceCoreEntry);
+    for (size_t i = 0; i < cores.size(); i++) {
+        BinaryTraceCoreEntry entry;
+        entry.recordCount = cores[i].recordCount();
+        entry.byteOffset = offset;
+        entry.byteLength = cores[i].data().size();
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        offset += entry.byteLength;
+    }
+    for (size_t i = 0; i < cores.size(); i++) {
+        const std::vector<unsigned char>& bytes = cores[i].data();
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    if (!out) {
+        throw std::runtime_error("error writing binary trace: " + fileName);
+    }
+}
+
+std::string traceFileName(const std::string& prefix, int core) {
+    return prefix + "_proc" + std::to_string(core) + ".trace";
+}
+
+bool isBinaryTraceFile(const std::string& fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    char magic[4];
+    return in.read(magic, sizeof(magic)) && memcmp(magic, BINARY_TRACE_MAGIC, sizeof(magic)) == 0;
+}
+
+static std::vector<std::unique_ptr<TraceSource> > openBinaryTrace(const std::string& fileName, int numCores) {
+    std::shared_ptr<MappedFile> file(new MappedFile(fileName));
+    if (file->size() < sizeof(BinaryTraceHeader)) {
+        throw std::runtime_error("truncated binary trace: " + fileName);
+    }
+    BinaryTraceHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (header.version != BINARY_TRACE_VERSION) {
+        throw std::runtime_error("unsupported binary trace version " + std::to_string(header.version) +
+                                 " in " + fileName);
+    }
+    if (header.numCores == 0) {
+        throw std::runtime_error("binary trace " + fileName + " holds no cores");
+    }
+    if (numCores > 0 && (int)header.numCores != numCores) {
+        throw std::runtime_error(fileName + " holds " + std::to_string(header.numCores) +
+                                 " cores, expected " + std::to_string(numCores));
+    }
+    if (file->size() < sizeof(header) + header.numCores * sizeof(BinaryTraceCoreEntry)) {
+        throw std::runtime_error("truncated binary trace: " + fileName);
+    }
+
+    std::vector<std::unique_ptr<TraceSource> > sources;
+    const char* entries = file->data() + sizeof(header);
+    for (uint32_t i = 0; i < header.numCores; i++) {
+        BinaryTraceCoreEntry entry;
+        memcpy(&entry, entries + i * sizeof(entry), sizeof(entry));
+        sources.emplace_back(new BinaryTraceSource(file, entry));
+    }
+    return sources;
+}
+
+int countTextTraces(const std::string& prefix) {
+    int numCores = 0;
+    struct stat st;
+    while (stat(traceFileName(prefix, numCores).c_str(), &st) == 0) {
+        numCores++;
+    }
+    return numCores;
+}
+
+std::vector<std::unique_ptr<TraceSource> > openTraceSources(const std::string& prefix, int numCores) {
+    std::vector<std::unique_ptr<TraceSource> > sources;
+    std::string binaryName = prefix + BINARY_TRACE_EXTENSION;
+    if (isSyntheticTrace(prefix)) {
+        sources = openSyntheticTrace(prefix, numCores);
+    } else if (isBinaryTraceFile(prefix)) {
+        sources = openBinaryTrace(prefix, numCores);
+    } else if (isBinaryTraceFile(binaryName)) {
+        sources = openBinaryTrace(binaryName, numCores);
+    } else {
+        if (numCores <= 0) {
+            numCores = countTextTraces(prefix);
+        }
+        for (int i = 0; i < numCores; i++) {
+            sources.emplace_back(new TextTraceSource(traceFileName(prefix, i)));
+        }
+    }
+    // The simulator needs at least one core
+    if (sources.empty()) {
+        throw std::runtime_error("no trace files found for prefix " + prefix);
+    }
+    return sources;
+}
+
+std::vector<std::vector<TraceRecord> > loadTraces(const std::string& prefix, int numCores) {
+    std::vector<std::unique_ptr<TraceSource> > sources = openTraceSources(prefix, numCores);
+    std::vector<std::vector<TraceRecord> > traces(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        const TraceRecord* chunk = nullptr;
+        size_t n;
+        while ((n = sources[i]->nextChunk(chunk)) > 0) {
+            traces[i].insert(traces[i].end(), chunk, chunk + n);
+        }
+        sources[i].reset(); // release the file / decode buffers before the next core
+    }
+    return traces;
+}
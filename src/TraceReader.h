@@ -0,0 +1,185 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include "utils.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// One decoded trace reference
+struct TraceRecord {
+    uint64_t address;
+    MemoryOperation op;
+};
+
+inline std::string recordToString(const TraceRecord& record) {
+    return std::string(record.op == WRITE ? "W " : "R ") + toHex(record.address);
+}
+
+// Waits on the ring between a background reader and the simulator (see TracePrefetch.h)
+struct TraceStallCounters {
+    uint64_t ringFull;  // the reader found the ring full and had to wait
+    uint64_t ringEmpty; // the simulator found the ring empty and had to wait
+};
+
+// Where a source can resume decoding (see TraceSource::seek). Apart from kind, the fields mean
+// what the source needs them to mean, e.g. a file offset and the decoder state at it.
+enum TracePositionKind {
+    TRACE_POSITION_TEXT = 1,
+    TRACE_POSITION_BINARY = 2,
+    TRACE_POSITION_ARRAY = 3,
+    TRACE_POSITION_SYNTHETIC = 4
+};
+
+struct TracePosition {
+    uint32_t kind; // TracePositionKind of the source it came from
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t state;
+    uint64_t remaining;
+};
+
+// Per-core stream of decoded references. Records are handed out in chunks so
+// the simulator pays one virtual call per chunk rather than per reference.
+class TraceSource {
+public:
+    virtual ~TraceSource() {}
+    // Points `chunk` at the next batch of records and returns its length, 0 at end of trace.
+    // The chunk stays valid until the next call.
+    virtual size_t nextChunk(const TraceRecord*& chunk) = 0;
+    // Ring stall counts of a prefetched source; false for sources decoded on the caller's thread
+    virtual bool stallCounters(TraceStallCounters& counters) const { (void)counters; return false; }
+    // Position the chunk returned by the last nextChunk call was decoded from; false for
+    // sources that cannot seek (the caller then skips records instead)
+    virtual bool chunkStart(TracePosition& position) const { (void)position; return false; }
+    // Makes the next nextChunk call decode from a position chunkStart returned; false, with
+    // nothing changed, if the position came from another kind of source
+    virtual bool seek(const TracePosition& position) { (void)position; return false; }
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+private:
+    const char* base;
+    size_t length;
+
+public:
+    explicit MappedFile(const std::string& fileName);
+    ~MappedFile();
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+// Text traces: one "R 0x7fe891b0" / "W 0x..." reference per line. The file is mapped and
+// decoded a chunk at a time, so memory use does not grow with the trace.
+class TextTraceSource : public TraceSource {
+private:
+    MappedFile file;
+    std::string fileName;
+    const unsigned char* cursor;
+    const unsigned char* end;
+    size_t lineNo;
+    std::vector<TraceRecord> buffer;
+    TracePosition lastChunk;
+
+public:
+    explicit TextTraceSource(const std::string& fileName);
+    size_t nextChunk(const TraceRecord*& chunk);
+    bool chunkStart(TracePosition& position) const { position = lastChunk; return true; }
+    bool seek(const TracePosition& position);
+};
+
+// Walks a decoded trace owned elsewhere, e.g. one shared read-only by several simulators
+class ArrayTraceSource : public TraceSource {
+private:
+    const std::vector<TraceRecord>* records;
+    bool consumed;
+
+public:
+    explicit ArrayTraceSource(const std::vector<TraceRecord>& records) : records(&records), consumed(false) {}
+    size_t nextChunk(const TraceRecord*& chunk);
+    bool chunkStart(TracePosition& position) const;
+    bool seek(const TracePosition& position);
+};
+
+//
+// Binary trace format (.l1bt), little endian:
+//   BinaryTraceHeader
+//   BinaryTraceCoreEntry[numCores]
+//   per-core record streams
+// Each record is one LEB128 varint holding (zigzag(address - previous address) << 1) | isWrite,
+// with the previous address starting at 0 for every core.
+//
+const char BINARY_TRACE_MAGIC[4] = { 'L', '1', 'B', 'T' };
+const uint32_t BINARY_TRACE_VERSION = 1;
+const char* const BINARY_TRACE_EXTENSION = ".l1bt";
+
+struct BinaryTraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numCores;
+    uint32_t reserved;
+};
+
+struct BinaryTraceCoreEntry {
+    uint64_t recordCount;
+    uint64_t byteOffset;  // from the start of the file
+    uint64_t byteLength;
+};
+
+// Decodes one core's stream out of a mapped .l1bt file
+class BinaryTraceSource : public TraceSource {
+private:
+    std::shared_ptr<MappedFile> file;
+    const unsigned char* cursor;
+    const unsigned char* end;
+    uint64_t remaining;
+    uint64_t prevAddress;
+    std::vector<TraceRecord> buffer;
+    TracePosition lastChunk;
+
+public:
+    BinaryTraceSource(std::shared_ptr<MappedFile> file, const BinaryTraceCoreEntry& entry);
+    size_t nextChunk(const TraceRecord*& chunk);
+    bool chunkStart(TracePosition& position) const { position = lastChunk; return true; }
+    bool seek(const TracePosition& position);
+};
+
+// Streaming encoder for one core's records
+class BinaryTraceEncoder {
+private:
+    std::vector<unsigned char> bytes;
+    uint64_t prevAddress;
+    uint64_t count;
+
+public:
+    BinaryTraceEncoder() : prevAddress(0), count(0) {}
+    void append(const TraceRecord& record);
+    const std::vector<unsigned char>& data() const { return bytes; }
+    uint64_t recordCount() const { return count; }
+};
+
+// Writes a complete .l1bt file from one encoded stream per core
+void writeBinaryTrace(const std::string& fileName, const std::vector<BinaryTraceEncoder>& cores);
+
+std::string traceFileName(const std::string& prefix, int core);
+bool isBinaryTraceFile(const std::string& fileName);
+// Number of consecutive <prefix>_procN.trace files starting at _proc0
+int countTextTraces(const std::string& prefix);
+
+// Opens one source per core for the -t prefix. "synthetic:<pattern>,..." generates the
+// references in memory (see SyntheticTrace.h). A prefix naming a .l1bt file, or one with a
+// sibling "<prefix>.l1bt", is read in binary; otherwise <prefix>_procN.trace is used.
+// numCores <= 0 takes the count from the synthetic spec, the binary header or the _procN files.
+std::vector<std::unique_ptr<TraceSource> > openTraceSources(const std::string& prefix, int numCores = 0);
+
+// Decodes every core's trace for the prefix into memory
+std::vector<std::vector<TraceRecord> > loadTraces(const std::string& prefix, int numCores = 0);
+
+#endif // TRACE_READER_H
@@ -1,56 +1,233 @@
 #include "CacheSimulator.h"
+#include "Sweep.h"
+#include "StackDistance.h"
+#include "TracePrefetch.h"
+#include "SharedCache.h"
+#include "SplitBus.h"
 #include <iostream>
 #include <string>
 #include <cstdlib>
+#include <climits>
+#include <thread>
+#include <vector>
+#include <utility>
 #include <getopt.h>
 
 void printHelp() {
-    std::cout << "Usage: ./L1simulate -t <tracefile> -s <s> -E <E> -b <b> [-o <outfilename>] [-d] [-h]" << std::endl;
+    std::cout << "Usage: ./L1simulate -t <tracefile> -s <s> -E <E> -b <b> [-n <cores>] [-o <outfilename>] [-S <sweep>] [-M] [-P <threads>] [-Q <quantum>] [-A <quanta>] [-F <readers>] [-k <ratio>] [-I <detailed>,<warming>]"
+              << " [--checkpoint <file> --checkpoint-at <refs> | --checkpoint-cycle <cycle>] [--restore <file>] [--fast-forward <refs>] [--interval-stats <cycles> [--interval-out <file>]] [--replacement <policy>] [--l2 <spec>] [--split-bus <spec>] [-d] [-h]" << std::endl;
     std::cout << "Options:" << std::endl;
-    std::cout << "  -t <tracefile>: name of parallel application (e.g. app1) whose 4 traces are to be used" << std::endl;
+    std::cout << "  -t <tracefile>: name of parallel application (e.g. app1) whose traces are to be used" << std::endl;
+    std::cout << "                  (<tracefile>.l1bt or a .l1bt path is read as a binary trace, see traceconv)" << std::endl;
+    std::cout << "                  or a generated workload \"synthetic:<pattern>[,key=value...]\", with pattern one of" << std::endl;
+    std::cout << "                  sequential, uniform, zipf, producer-consumer, migratory, false-sharing, lock-pingpong" << std::endl;
+    std::cout << "                  and keys cores=, refs= (per core), seed=, footprint= (bytes), writes= (%), alpha= (zipf)" << std::endl;
     std::cout << "  -s <s>: number of set index bits (number of sets in the cache = S = 2^s)" << std::endl;
     std::cout << "  -E <E>: associativity (number of cache lines per set)" << std::endl;
     std::cout << "  -b <b>: number of block bits (block size = B = 2^b)" << std::endl;
+    std::cout << "  -n <cores>: number of cores, one trace each (default: every consecutive _procN file found," << std::endl;
+    std::cout << "              or the core count stored in a binary trace)" << std::endl;
     std::cout << "  -o <outfilename>: logs output in file for plotting etc." << std::endl;
-    std::cout << "  -d: enable debug mode (prints cache state after each instruction)" << std::endl;
+    std::cout << "  -S <sweep>: simulate many geometries from one trace decode, e.g. \"s=4..8,E=1,2,4,8,b=5,6\"" << std::endl;
+    std::cout << "              (parameters left out of the spec come from -s/-E/-b; writes one CSV table)" << std::endl;
+    std::cout << "  -M: stack-distance analysis: miss-rate curves over associativity (2^s sets) and" << std::endl;
+    std::cout << "      fully-associative size, from one pass over each core's trace" << std::endl;
+    std::cout << "  -P <threads>: parallel mode, groups of cores simulated on worker threads that" << std::endl;
+    std::cout << "                synchronize every quantum (approximates the serial results)" << std::endl;
+    std::cout << "  -Q <quantum>: cycles between synchronizations in parallel mode (default: 1000)" << std::endl;
+    std::cout << "  -A <quanta>: accuracy report of parallel mode, e.g. \"10,100,1000,10000\": CSV of wall time" << std::endl;
+    std::cout << "               and relative error against the serial run for each quantum (threads from -P)" << std::endl;
+    std::cout << "  -F <readers>: read and decode the traces ahead on this many background threads," << std::endl;
+    std::cout << "                through a bounded ring per core (reports ring full/empty stalls)" << std::endl;
+    std::cout << "  -k <ratio>: set sampling, simulate one set in every <ratio> and extrapolate" << std::endl;
+    std::cout << "  -I <detailed>,<warming>[,<warmup>]: interval sampling, alternate windows of detailed" << std::endl;
+    std::cout << "                simulation and of cache warming only, each detailed window preceded by an" << std::endl;
+    std::cout << "                unmeasured warm-up (default <detailed>; sizes in references over all cores)" << std::endl;
+    std::cout << "              (sampled statistics are printed with 95% confidence intervals)" << std::endl;
+    std::cout << "  --checkpoint <file>: save the complete simulator state to <file> once --checkpoint-at" << std::endl;
+    std::cout << "                       references (over all cores) have retired, or at the end of cycle" << std::endl;
+    std::cout << "                       --checkpoint-cycle, then simulate on to the end" << std::endl;
+    std::cout << "  --restore <file>: resume from a checkpoint taken with the same traces and -s/-E/-b" << std::endl;
+    std::cout << "  --fast-forward <refs>: run the first <refs> references of each core through the caches and" << std::endl;
+    std::cout << "                         coherence states only, without timing (reported separately)" << std::endl;
+    std::cout << "  --interval-stats <cycles>: record per-core hits, misses, idle cycles, invalidations and bus" << std::endl;
+    std::cout << "                             occupancy for every <cycles> cycles (serial engines only)" << std::endl;
+    std::cout << "  --interval-out <file>: where the intervals go (default: intervals.csv); a .l1is name" << std::endl;
+    std::cout << "                         is written in binary instead of CSV" << std::endl;
+    std::cout << "  --replacement <policy>: replacement policy of the caches: lru (default), plru (tree-PLRU," << std::endl;
+    std::cout << "                          power-of-two E), srrip, brrip or random; builds with" << std::endl;
+    std::cout << "                          make REPLACEMENT=<POLICY> support only that one" << std::endl;
+    std::cout << "  --l2 <spec>: shared L2 between the L1s and memory, e.g. \"size=256K,ways=8,latency=12,banks=4," << std::endl;
+    std::cout << "               inclusion=inclusive\" (inclusive with back-invalidation, non-inclusive or exclusive;" << std::endl;
+    std::cout << "               only size is required; not with sampling)" << std::endl;
+    std::cout << "  --split-bus <spec>: split-transaction bus instead of the atomic one, e.g." << std::endl;
+    std::cout << "                      \"address=1,data=8,outstanding=8\" (address and data bus cycles per" << std::endl;
+    std::cout << "                      request and block, transactions in flight), or \"default\"" << std::endl;
+    std::cout << "  --log-level <0-3>: text log of the run: 1 = misses, coherence changes and evictions," << std::endl;
+    std::cout << "                     2 = also every access and stall, 3 = also every cycle (default: 0," << std::endl;
+    std::cout << "                     3 with -d; builds with make LOG_LEVEL=n drop the levels above n)" << std::endl;
+    std::cout << "  --event-log <file>: write every hit, miss, upgrade, snoop and eviction to <file> in" << std::endl;
+    std::cout << "                      binary from a background thread (print it with bin/eventlog)" << std::endl;
+    std::cout << "  --check-data: carry a version of each block in the L1 lines through every fill, transfer" << std::endl;
+    std::cout << "                and write back, and stop at the first read that misses the last write" << std::endl;
+    std::cout << "                (serial engines without checkpoints)" << std::endl;
+    std::cout << "  -d: enable debug mode (cycle-by-cycle engine with the full text log)" << std::endl;
     std::cout << "  -h: prints this help" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
     std::string traceFile;
     int s = 0, E = 0, b = 0;
+    int numCores = 0; // 0 = detect from the trace files
     std::string outFileName;
+    std::string sweepSpec;
     bool debugMode = false;
+    bool missRateCurves = false;
+    int parallelThreads = 0;
+    int quantum = 1000;
+    std::string studyQuanta;
+    int prefetchThreads = 0;
+    SamplingConfig sampling;
+    std::string checkpointFile;
+    long long checkpointAtRefs = LLONG_MAX;
+    long long checkpointAtCycle = LLONG_MAX;
+    std::string restoreFile;
+    long long fastForwardRefs = 0;
+    int intervalCycles = 0;
+    std::string intervalFile = "intervals.csv";
+    int logLevel = -1; // -1 = as implied by -d
+    std::string eventLogFile;
+    std::string replacement; // empty = the build's default policy
+    std::string l2Spec;      // empty = no L2
+    std::string splitBusSpec; // empty = atomic bus
+    bool checkData = false;
+    
+    // Long-only options
+    enum { OPT_CHECKPOINT = 256, OPT_CHECKPOINT_AT, OPT_CHECKPOINT_CYCLE, OPT_RESTORE, OPT_FAST_FORWARD,
+           OPT_INTERVAL_STATS, OPT_INTERVAL_OUT, OPT_LOG_LEVEL, OPT_EVENT_LOG,
+           OPT_REPLACEMENT, OPT_L2, OPT_SPLIT_BUS, OPT_CHECK_DATA };
+    static const struct option longOptions[] = {
+        { "checkpoint", required_argument, nullptr, OPT_CHECKPOINT },
+        { "checkpoint-at", required_argument, nullptr, OPT_CHECKPOINT_AT },
+        { "checkpoint-cycle", required_argument, nullptr, OPT_CHECKPOINT_CYCLE },
+        { "restore", required_argument, nullptr, OPT_RESTORE },
+        { "fast-forward", required_argument, nullptr, OPT_FAST_FORWARD },
+        { "interval-stats", required_argument, nullptr, OPT_INTERVAL_STATS },
+        { "interval-out", required_argument, nullptr, OPT_INTERVAL_OUT },
+        { "log-level", required_argument, nullptr, OPT_LOG_LEVEL },
+        { "event-log", required_argument, nullptr, OPT_EVENT_LOG },
+        { "replacement", required_argument, nullptr, OPT_REPLACEMENT },
+        { "l2", required_argument, nullptr, OPT_L2 },
+        { "split-bus", required_argument, nullptr, OPT_SPLIT_BUS },
+        { "check-data", no_argument, nullptr, OPT_CHECK_DATA },
+        { nullptr, 0, nullptr, 0 }
+    };
     
     // Parse command line arguments
     int opt;
-    while ((opt = getopt(argc, argv, "t:s:E:b:o:dh")) != -1) {
-        switch (opt) {
-            case 't':
-                traceFile = optarg;
-                break;
-            case 's':
-                s = std::stoi(optarg);
-                break;
-            case 'E':
-                E = std::stoi(optarg);
-                break;
-            case 'b':
-                b = std::stoi(optarg);
-                break;
-            case 'o':
-                outFileName = optarg;
-                break;
-            case 'd':
-                debugMode = true;
-                break;
-            case 'h':
-                printHelp();
-                return 0;
-            default:
-                printHelp();
-                return 1;
+    try {
+        while ((opt = getopt_long(argc, argv, "t:s:E:b:n:o:S:MP:Q:A:F:k:I:dh", longOptions, nullptr)) != -1) {
+            switch (opt) {
+                case 't':
+                    traceFile = optarg;
+                    break;
+                case 's':
+                    s = std::stoi(optarg);
+                    break;
+                case 'E':
+                    E = std::stoi(optarg);
+                    break;
+                case 'b':
+                    b = std::stoi(optarg);
+                    break;
+                case 'n':
+                    numCores = std::stoi(optarg);
+                    break;
+                case 'o':
+                    outFileName = optarg;
+                    break;
+                case 'S':
+                    sweepSpec = optarg;
+                    break;
+                case 'M':
+                    missRateCurves = true;
+                    break;
+                case 'P':
+                    parallelThreads = std::stoi(optarg);
+                    break;
+                case 'Q':
+                    quantum = std::stoi(optarg);
+                    break;
+                case 'A':
+                    studyQuanta = optarg;
+                    break;
+                case 'F':
+                    prefetchThreads = std::stoi(optarg);
+                    break;
+                case 'k':
+                    sampling.setRatio = std::stoi(optarg);
+                    break;
+                case 'I': {
+                    SamplingConfig interval = parseIntervalSpec(optarg);
+                    sampling.detailedRefs = interval.detailedRefs;
+                    sampling.warmingRefs = interval.warmingRefs;
+                    sampling.warmupRefs = interval.warmupRefs;
+                    break;
+                }
+                case OPT_CHECKPOINT:
+                    checkpointFile = optarg;
+                    break;
+                case OPT_CHECKPOINT_AT:
+                    checkpointAtRefs = std::stoll(optarg);
+                    break;
+                case OPT_CHECKPOINT_CYCLE:
+                    checkpointAtCycle = std::stoll(optarg);
+                    break;
+                case OPT_RESTORE:
+                    restoreFile = optarg;
+                    break;
+                case OPT_FAST_FORWARD:
+                    fastForwardRefs = std::stoll(optarg);
+                    break;
+                case OPT_INTERVAL_STATS:
+                    intervalCycles = std::stoi(optarg);
+                    break;
+                case OPT_INTERVAL_OUT:
+                    intervalFile = optarg;
+                    break;
+                case OPT_LOG_LEVEL:
+                    logLevel = std::stoi(optarg);
+                    break;
+                case OPT_EVENT_LOG:
+                    eventLogFile = optarg;
+                    break;
+                case OPT_REPLACEMENT:
+                    replacement = optarg;
+                    break;
+                case OPT_L2:
+                    l2Spec = optarg;
+                    break;
+                case OPT_SPLIT_BUS:
+                    splitBusSpec = optarg;
+                    break;
+                case OPT_CHECK_DATA:
+                    checkData = true;
+                    break;
+                case 'd':
+                    debugMode = true;
+                    break;
+                case 'h':
+                    printHelp();
+                    return 0;
+                default:
+                    printHelp();
+                    return 1;
+            }
         }
+    } catch (const std::exception& e) {
+        // std::stoi and friends only say which conversion failed
+        std::cerr << "Error: invalid value '" << optarg << "': " << e.what() << std::endl;
+        return 1;
     }
     
     // Validate parameters
@@ -60,24 +237,138 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    if (s <= 0) {
-        std::cerr << "Error: Invalid set index bits (-s)" << std::endl;
+    if (numCores < 0) {
+        std::cerr << "Error: Invalid number of cores (-n)" << std::endl;
+        return 1;
+    }
+    
+    // -S, -M and -A run simulations of their own, which take none of the single run's options
+    const char* study = !sweepSpec.empty() ? "-S" : missRateCurves ? "-M" : !studyQuanta.empty() ? "-A" : nullptr;
+    if ((!sweepSpec.empty()) + missRateCurves + (!studyQuanta.empty()) > 1) {
+        std::cerr << "Error: only one of -S, -M and -A can be given" << std::endl;
+        return 1;
+    }
+    if (study) {
+        const std::pair<bool, const char*> unsupported[] = {
+            { parallelThreads > 0 && studyQuanta.empty(), "-P" },
+            { debugMode, "-d" },
+            { prefetchThreads > 0, "-F" },
+            { sampling.enabled(), "-k or -I" },
+            { !replacement.empty(), "--replacement" },
+            { !l2Spec.empty(), "--l2" },
+            { !splitBusSpec.empty(), "--split-bus" },
+            { !checkpointFile.empty() || !restoreFile.empty(), "--checkpoint or --restore" },
+            { fastForwardRefs != 0, "--fast-forward" },
+            { intervalCycles != 0, "--interval-stats" },
+            { !eventLogFile.empty(), "--event-log" },
+            { checkData, "--check-data" },
+        };
+        for (const std::pair<bool, const char*>& option : unsupported) {
+            if (option.first) {
+                std::cerr << "Error: " << study << " cannot be combined with " << option.second << std::endl;
+                return 1;
+            }
+        }
+    }
+    
+    if (!sweepSpec.empty()) {
+        try {
+            std::vector<SweepConfig> configs = parseSweepSpec(sweepSpec, s, E, b);
+            runSweep(traceFile, configs, outFileName, (int)std::thread::hardware_concurrency(),
+                     numCores);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    
+    // The set count and the block size are ints, and s + b stays below the 64 address bits
+    if (s <= 0 || s > 30) {
+        std::cerr << "Error: Invalid set index bits (-s), must be between 1 and 30" << std::endl;
+        return 1;
+    }
+    
+    if (b <= 0 || b > 30) {
+        std::cerr << "Error: Invalid block bits (-b), must be between 1 and 30" << std::endl;
         return 1;
     }
     
+    if (missRateCurves) {
+        try {
+            runStackDistanceAnalysis(traceFile, s, b, E, outFileName, numCores);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    
     if (E <= 0) {
         std::cerr << "Error: Invalid associativity (-E)" << std::endl;
         return 1;
     }
     
-    if (b <= 0) {
-        std::cerr << "Error: Invalid block bits (-b)" << std::endl;
+    if (parallelThreads < 0 || quantum <= 0) {
+        std::cerr << "Error: Invalid parallel mode settings (-P/-Q)" << std::endl;
+        return 1;
+    }
+    
+    if (!checkpointFile.empty() && checkpointAtRefs == LLONG_MAX && checkpointAtCycle == LLONG_MAX) {
+        std::cerr << "Error: --checkpoint needs --checkpoint-at or --checkpoint-cycle" << std::endl;
         return 1;
     }
     
+    if (!studyQuanta.empty()) {
+        try {
+            int threads = (parallelThreads > 0) ? parallelThreads : (int)std::thread::hardware_concurrency();
+            runQuantumStudy(traceFile, s, E, b, parseValueList(studyQuanta), std::max(threads, 1),
+                            outFileName, numCores);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    
     // Create and run the simulator
     try {
-        CacheSimulator simulator(traceFile, s, E, b, outFileName, debugMode);
+        std::vector<std::unique_ptr<TraceSource> > sources = openTraceSources(traceFile, numCores);
+        if (prefetchThreads > 0) {
+            sources = prefetchTraceSources(std::move(sources), prefetchThreads);
+        }
+        CacheSimulator simulator(std::move(sources), s, E, b, outFileName, debugMode, logLevel);
+        if (!replacement.empty()) {
+            simulator.setReplacementPolicy(parseReplacementPolicy(replacement));
+        }
+        if (!l2Spec.empty()) {
+            simulator.setSharedCache(parseSharedCacheSpec(l2Spec));
+        }
+        if (!splitBusSpec.empty()) {
+            simulator.setSplitBus(parseSplitBusSpec(splitBusSpec));
+        }
+        if (!eventLogFile.empty()) {
+            simulator.setEventLog(eventLogFile);
+        }
+        if (checkData) {
+            simulator.setDataCheck();
+        }
+        if (!restoreFile.empty()) {
+            simulator.restoreCheckpoint(restoreFile);
+        }
+        if (fastForwardRefs != 0) {
+            simulator.setFastForward(fastForwardRefs);
+        }
+        if (!checkpointFile.empty()) {
+            simulator.setCheckpoint(checkpointFile, checkpointAtRefs, checkpointAtCycle);
+        }
+        if (intervalCycles != 0) {
+            simulator.setIntervalStats(intervalFile, intervalCycles);
+        }
+        if (parallelThreads > 0) {
+            simulator.setParallel(parallelThreads, quantum);
+        }
+        simulator.setSampling(sampling);
         simulator.runSimulation();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
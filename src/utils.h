@@ -9,6 +9,7 @@
 #include <cmath>
 #include <algorithm>
 #include <iomanip>
+#include <cstdint>
 
 // Memory operation types
 enum MemoryOperation {
@@ -36,6 +37,13 @@ inline std::string stateToString(CacheLineState state) {
     }
 }
 
+// Hex form of an address as it appears in the traces, e.g. 0x7fe891b0
+inline std::string toHex(uint64_t address) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << address;
+    return oss.str();
+}
+
 // Bus transaction types
 // enum BusTransaction {
 //     BUS_READ,
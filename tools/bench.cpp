@@ -0,0 +1,306 @@
+// Throughput benchmark of the simulator: the shipped traces plus large generated workloads,
+// written as CSV and optionally checked against a saved baseline
+#include "CacheSimulator.h"
+#include "TraceReader.h"
+#include "SyntheticTrace.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <getopt.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+void printHelp() {
+    std::cout << "Usage: ./bench [-d <tracedir>] [-n <refs>] [-s <s>] [-E <E>] [-b <b>] [-r <repeats>] [-o <outfilename>]"
+              << " [-B <baseline>] [-T <percent>] [-h]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -d <tracedir>: directory of shipped <app>_procN.trace files (default: assignment3_traces)" << std::endl;
+    std::cout << "  -n <refs>: references per core of the synthetic workloads (default: 1000000)" << std::endl;
+    std::cout << "  -s <s>, -E <E>, -b <b>: cache geometry (default: s=6, E=2, b=5)" << std::endl;
+    std::cout << "  -r <repeats>: simulate each workload this many times and keep the fastest (default: 1)" << std::endl;
+    std::cout << "  -o <outfilename>: write the CSV results to a file instead of stdout" << std::endl;
+    std::cout << "  -B <baseline>: CSV of an earlier run; exits with 1 if a workload got slower than the threshold" << std::endl;
+    std::cout << "                 (workloads simulated in under 100 ms are not compared)" << std::endl;
+    std::cout << "  -T <percent>: allowed drop in references per second against the baseline (default: 10)" << std::endl;
+    std::cout << "  -h: prints this help" << std::endl;
+}
+
+struct Workload {
+    std::string name;
+    std::vector<std::string> files; // shipped trace files, one per core
+    std::string synthetic;          // -t spec of a generated workload (see SyntheticTrace.h), or empty
+    int cores;
+};
+
+// What one workload measured; sent back from the child process that ran it
+struct BenchResult {
+    long long references;
+    double decodeMs;   // reading and decoding the trace files, or generating the synthetic trace
+    double simulateMs; // fastest simulate() over the repeats
+};
+
+// Shipped workloads: every <app> with at least one <app>_procN.trace in dir, cores in N order
+static std::vector<Workload> findShippedWorkloads(const std::string& dir) {
+    std::map<std::string, std::map<int, std::string> > apps;
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        std::cerr << "Warning: no shipped traces, cannot open " << dir << std::endl;
+        return std::vector<Workload>();
+    }
+    while (struct dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        size_t proc = name.rfind("_proc");
+        const std::string suffix = ".trace";
+        if (proc == std::string::npos || name.size() <= suffix.size() ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        std::string number = name.substr(proc + 5, name.size() - suffix.size() - proc - 5);
+        if (number.empty() || number.find_first_not_of("0123456789") != std::string::npos) continue;
+        apps[name.substr(0, proc)][std::stoi(number)] = dir + "/" + name;
+    }
+    closedir(d);
+
+    std::vector<Workload> workloads;
+    for (const auto& app : apps) {
+        Workload w;
+        w.name = app.first;
+        for (const auto& file : app.second) {
+            w.files.push_back(file.second);
+        }
+        w.cores = (int)w.files.size();
+        workloads.push_back(w);
+    }
+    return workloads;
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static BenchResult runWorkload(const Workload& w, long long syntheticRefs, int s, int E, int b, int repeats) {
+    BenchResult result = BenchResult();
+    std::vector<std::vector<TraceRecord> > traces;
+    auto start = std::chrono::steady_clock::now();
+    if (w.synthetic.empty()) {
+        traces.resize(w.cores);
+        for (int i = 0; i < w.cores; i++) {
+            TextTraceSource source(w.files[i]);
+            const TraceRecord* chunk = nullptr;
+            size_t n;
+            while ((n = source.nextChunk(chunk)) > 0) {
+                traces[i].insert(traces[i].end(), chunk, chunk + n);
+            }
+        }
+    } else {
+        traces = loadTraces(w.synthetic + ",refs=" + std::to_string(syntheticRefs), w.cores);
+    }
+    for (const std::vector<TraceRecord>& trace : traces) {
+        result.references += (long long)trace.size();
+    }
+    result.decodeMs = millisecondsSince(start);
+
+    result.simulateMs = -1.0;
+    for (int r = 0; r < repeats; r++) {
+        std::vector<std::unique_ptr<TraceSource> > sources;
+        for (const std::vector<TraceRecord>& trace : traces) {
+            sources.emplace_back(new ArrayTraceSource(trace));
+        }
+        CacheSimulator simulator(std::move(sources), s, E, b, "");
+        start = std::chrono::steady_clock::now();
+        simulator.simulate();
+        double ms = millisecondsSince(start);
+        if (result.simulateMs < 0 || ms < result.simulateMs) {
+            result.simulateMs = ms;
+        }
+    }
+    return result;
+}
+
+// Runs the workload in a child process so its peak RSS is its own
+static BenchResult runIsolated(const Workload& w, long long syntheticRefs, int s, int E, int b, int repeats,
+                               long& peakRssKb) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        throw std::runtime_error("cannot create pipe");
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("cannot fork");
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        int status = 0;
+        try {
+            BenchResult result = runWorkload(w, syntheticRefs, s, E, b, repeats);
+            if (write(fds[1], &result, sizeof(result)) != (ssize_t)sizeof(result)) status = 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << w.name << ": " << e.what() << std::endl;
+            status = 1;
+        }
+        close(fds[1]);
+        _exit(status);
+    }
+
+    close(fds[1]);
+    BenchResult result = BenchResult();
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        got != (ssize_t)sizeof(result)) {
+        throw std::runtime_error("workload " + w.name + " failed");
+    }
+    peakRssKb = usage.ru_maxrss; // kilobytes on Linux
+    return result;
+}
+
+// Runs shorter than this are reported but not compared: timer noise swamps them
+const double MIN_COMPARED_MS = 100.0;
+
+// workload name -> refs_per_sec of a CSV written by an earlier run, for the runs long enough to compare
+static std::map<std::string, double> readBaseline(const std::string& fileName) {
+    std::ifstream in(fileName);
+    if (!in.is_open()) {
+        throw std::runtime_error("cannot open baseline: " + fileName);
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            fields.push_back(field);
+        }
+        if (fields.size() >= 6 && std::stod(fields[4]) >= MIN_COMPARED_MS) {
+            baseline[fields[0]] = std::stod(fields[5]);
+        }
+    }
+    return baseline;
+}
+
+int main(int argc, char* argv[]) {
+    std::string traceDir = "assignment3_traces";
+    long long syntheticRefs = 1000000;
+    int s = 6, E = 2, b = 5;
+    int repeats = 1;
+    std::string outFileName;
+    std::string baselineFile;
+    double threshold = 10.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:n:s:E:b:r:o:B:T:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                traceDir = optarg;
+                break;
+            case 'n':
+                syntheticRefs = std::stoll(optarg);
+                break;
+            case 's':
+                s = std::stoi(optarg);
+                break;
+            case 'E':
+                E = std::stoi(optarg);
+                break;
+            case 'b':
+                b = std::stoi(optarg);
+                break;
+            case 'r':
+                repeats = std::stoi(optarg);
+                break;
+            case 'o':
+                outFileName = optarg;
+                break;
+            case 'B':
+                baselineFile = optarg;
+                break;
+            case 'T':
+                threshold = std::stod(optarg);
+                break;
+            case 'h':
+                printHelp();
+                return 0;
+            default:
+                printHelp();
+                return 1;
+        }
+    }
+    if (s <= 0 || E <= 0 || b <= 0 || repeats <= 0 || syntheticRefs <= 0 || threshold < 0) {
+        std::cerr << "Error: Invalid benchmark settings" << std::endl;
+        return 1;
+    }
+
+    std::vector<Workload> workloads = findShippedWorkloads(traceDir);
+    // Generated workloads: the private patterns span the hit path (sequential), a miss on nearly
+    // every access (uniform over 16 MB) and a skewed mix (zipf); the rest exercise coherence
+    const char* const synthetic[] = {
+        "sequential", "uniform,footprint=16M", "zipf", "producer-consumer", "migratory", "false-sharing",
+        "lock-pingpong"
+    };
+    for (const char* spec : synthetic) {
+        Workload w;
+        std::string pattern = spec;
+        w.name = "synthetic-" + pattern.substr(0, pattern.find(','));
+        w.synthetic = SYNTHETIC_TRACE_PREFIX + pattern;
+        w.cores = 4;
+        workloads.push_back(w);
+    }
+
+    try {
+        std::map<std::string, double> baseline;
+        if (!baselineFile.empty()) {
+            baseline = readBaseline(baselineFile);
+        }
+
+        std::ofstream outFile;
+        if (!outFileName.empty()) {
+            outFile.open(outFileName);
+        }
+        std::ostream &out = (outFile.is_open() ? outFile : std::cout);
+        out << "workload,cores,references,decode_ms,simulate_ms,refs_per_sec,ns_per_access,peak_rss_kb" << std::endl;
+
+        bool regressed = false;
+        for (const Workload& w : workloads) {
+            long peakRssKb = 0;
+            BenchResult r = runIsolated(w, syntheticRefs, s, E, b, repeats, peakRssKb);
+            double seconds = std::max(r.simulateMs, 1e-3) / 1000.0;
+            double refsPerSec = r.references / seconds;
+            double nsPerAccess = (r.references > 0) ? r.simulateMs * 1e6 / r.references : 0.0;
+            out << w.name << "," << w.cores << "," << r.references << "," << std::fixed << std::setprecision(3)
+                << r.decodeMs << "," << r.simulateMs << "," << std::setprecision(0) << refsPerSec << ","
+                << std::setprecision(2) << nsPerAccess << "," << peakRssKb << std::endl;
+
+            auto base = baseline.find(w.name);
+            if (base != baseline.end() && base->second > 0 && r.simulateMs >= MIN_COMPARED_MS) {
+                double change = 100.0 * (refsPerSec - base->second) / base->second;
+                bool slower = change < -threshold;
+                regressed = regressed || slower;
+                std::cerr << w.name << ": " << std::fixed << std::setprecision(1) << change
+                          << "% references/s against the baseline" << (slower ? " (REGRESSION)" : "") << std::endl;
+            }
+        }
+        if (regressed) {
+            std::cerr << "Error: throughput dropped more than " << threshold << "% below the baseline" << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Checks coherence with data: every generated sharing pattern runs with the data check on each
+// engine and memory system, where each read must return the last write to its block through the
+// cache-to-cache transfers, write backs and L2 fills, and the counts must match a run without it
+#include "CacheSimulator.h"
+#include "TraceReader.h"
+#include "Sampling.h"
+#include "SharedCache.h"
+#include "SplitBus.h"
+#include "Log.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <cstring>
+
+struct Setup {
+    const char* name;
+    bool debug;      // cycle-by-cycle engine
+    const char* l2;  // L2 spec, or nullptr
+    const char* splitBus;
+    const char* interval; // interval sampling spec, or nullptr
+};
+
+static int failures = 0;
+static int checks = 0;
+
+static SimulationSummary simulate(const std::string& spec, const Setup& setup, bool dataCheck,
+                                  long long& checkedReads) {
+    CacheSimulator simulator(openTraceSources(spec), 4, 2, 5, "", setup.debug, LOG_LEVEL_OFF);
+    if (setup.l2) simulator.setSharedCache(parseSharedCacheSpec(setup.l2));
+    if (setup.splitBus) simulator.setSplitBus(parseSplitBusSpec(setup.splitBus));
+    if (setup.interval) simulator.setSampling(parseIntervalSpec(setup.interval));
+    if (dataCheck) simulator.setDataCheck();
+    simulator.simulate();
+    checkedReads = simulator.checkedReadCount();
+    return simulator.summary();
+}
+
+int main() {
+    const char* patterns[] = { "sequential", "uniform", "zipf", "producer-consumer", "migratory",
+                               "false-sharing", "lock-pingpong" };
+    // A 1KB L2 under 4 x 512B L1s evicts blocks still held above
+    const Setup setups[] = {
+        { "event loop", false, nullptr, nullptr, nullptr },
+        { "cycle loop", true, nullptr, nullptr, nullptr },
+        { "inclusive L2", false, "size=1K,ways=2,inclusion=inclusive", nullptr, nullptr },
+        { "non-inclusive L2", false, "size=1K,ways=2,inclusion=non-inclusive", nullptr, nullptr },
+        { "exclusive L2", false, "size=1K,ways=2,inclusion=exclusive", nullptr, nullptr },
+        { "split bus", false, nullptr, "default", nullptr },
+        { "interval sampling", false, nullptr, nullptr, "500,2000" },
+    };
+
+    for (const char* pattern : patterns) {
+        std::string spec = std::string("synthetic:") + pattern + ",cores=4,refs=20000";
+        for (const Setup& setup : setups) {
+            checks++;
+            try {
+                long long checkedReads;
+                SimulationSummary plain = simulate(spec, setup, false, checkedReads);
+                SimulationSummary checked = simulate(spec, setup, true, checkedReads);
+                if (checkedReads == 0) {
+                    failures++;
+                    std::cerr << "FAIL: " << pattern << ", " << setup.name << ": no read checked" << std::endl;
+                } else if (memcmp(&plain, &checked, sizeof(plain)) != 0) {
+                    failures++;
+                    std::cerr << "FAIL: " << pattern << ", " << setup.name << ": the data check changed the counts"
+                              << std::endl;
+                }
+            } catch (const std::exception& e) {
+                failures++;
+                std::cerr << "FAIL: " << pattern << ", " << setup.name << ": " << e.what() << std::endl;
+            }
+        }
+    }
+
+    if (failures > 0) {
+        std::cout << failures << " of " << checks << " runs read stale data or changed with the data check" << std::endl;
+        return 1;
+    }
+    std::cout << "data check: " << checks << " runs read the last write everywhere" << std::endl;
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Prints a binary event log written with L1simulate --event-log as text
+#include "CacheSimulator.h"
+#include "EventLog.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <climits>
+#include <getopt.h>
+
+void printHelp() {
+    std::cout << "Usage: ./eventlog -i <eventlog> [-c <core>] [-n <records>] [-h]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -i <eventlog>: event log written by L1simulate --event-log" << std::endl;
+    std::cout << "  -c <core>: only the events of this core" << std::endl;
+    std::cout << "  -n <records>: stop after printing this many events" << std::endl;
+    std::cout << "  -h: prints this help" << std::endl;
+}
+
+static void printRecord(const EventLogRecord& record) {
+    std::cout << "[Cycle " << record.cycle << "] Core " << record.core << " " << eventTypeName(record.type)
+              << " " << (record.op == WRITE ? "W " : "R ") << toHex(record.address) << " "
+              << stateToString((CacheLineState)record.oldState) << " -> "
+              << stateToString((CacheLineState)record.newState);
+    if (record.transaction != BusTransaction::None) {
+        std::cout << " " << busTransactionName(record.transaction);
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string fileName;
+    long long limit = LLONG_MAX;
+    long long onlyCore = -1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:c:n:h")) != -1) {
+        switch (opt) {
+            case 'i':
+                fileName = optarg;
+                break;
+            case 'c':
+                onlyCore = std::stoll(optarg);
+                break;
+            case 'n':
+                limit = std::stoll(optarg);
+                break;
+            case 'h':
+                printHelp();
+                return 0;
+            default:
+                printHelp();
+                return 1;
+        }
+    }
+
+    if (fileName.empty()) {
+        std::cerr << "Error: Missing event log (-i)" << std::endl;
+        printHelp();
+        return 1;
+    }
+
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Error: cannot open event log: " << fileName << std::endl;
+        return 1;
+    }
+    EventLogHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic)) != 0) {
+        std::cerr << "Error: not an event log: " << fileName << std::endl;
+        return 1;
+    }
+    if (header.version != EVENT_LOG_VERSION) {
+        std::cerr << "Error: unsupported event log version " << header.version << std::endl;
+        return 1;
+    }
+    std::cout << "# " << header.numCores << " cores, " << (1u << header.blockBits) << "-byte blocks" << std::endl;
+
+    std::vector<EventLogRecord> records(4096);
+    long long printed = 0;
+    while (printed < limit && in) {
+        in.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(EventLogRecord));
+        size_t n = (size_t)in.gcount() / sizeof(EventLogRecord);
+        for (size_t k = 0; k < n && printed < limit; k++) {
+            if (onlyCore >= 0 && records[k].core != (uint32_t)onlyCore) continue;
+            printRecord(records[k]);
+            printed++;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Checks interval sampling against full simulation on the generated sharing patterns: the
+// extrapolated misses, bus transactions, idle and elapsed cycles must land near the exact counts
+#include "CacheSimulator.h"
+#include "TraceReader.h"
+#include "Sampling.h"
+#include "Log.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+static int failures = 0;
+static int checks = 0;
+
+static SimulationSummary simulate(const std::string& spec, const SamplingConfig* sampling) {
+    CacheSimulator simulator(openTraceSources(spec), 4, 4, 5, "", false, LOG_LEVEL_OFF);
+    if (sampling) simulator.setSampling(*sampling);
+    simulator.simulate();
+    return simulator.summary();
+}
+
+static void check(const std::string& pattern, const char* stat, long long exact, long long estimate,
+                  double tolerance) {
+    checks++;
+    double error = (exact != 0) ? std::fabs((double)(estimate - exact)) / exact : (estimate != 0);
+    if (error > tolerance) {
+        failures++;
+        std::cerr << "FAIL: " << pattern << " " << stat << ": estimated " << estimate << ", exact "
+                  << exact << " (" << (int)(error * 100 + 0.5) << "% off)" << std::endl;
+    }
+}
+
+int main() {
+    // Cores contending for a few shared lines, where the result depends on how far apart the
+    // cores run and on the bus queue, which warming alone does not reproduce
+    const char* patterns[] = { "migratory", "lock-pingpong", "producer-consumer", "false-sharing" };
+    SamplingConfig sampling = parseIntervalSpec("2000,8000");
+
+    for (const char* pattern : patterns) {
+        std::string spec = std::string("synthetic:") + pattern + ",cores=8,refs=50000";
+        SimulationSummary exact = simulate(spec, nullptr);
+        SimulationSummary estimate = simulate(spec, &sampling);
+        check(pattern, "misses", exact.misses, estimate.misses, 0.10);
+        check(pattern, "bus transactions", exact.busTransactions, estimate.busTransactions, 0.10);
+        check(pattern, "idle cycles", exact.idleCycles, estimate.idleCycles, 0.15);
+        check(pattern, "cycles", exact.cycles, estimate.cycles, 0.15);
+    }
+
+    if (failures > 0) {
+        std::cout << failures << " of " << checks << " sampled estimates too far from the full simulation" << std::endl;
+        return 1;
+    }
+    std::cout << "interval sampling: " << checks << " estimates agree with the full simulation" << std::endl;
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Checks that the SIMD tag matchers agree with the scalar one: every associativity from 1 to 64,
+// random tags with invalid ways, duplicates and near misses, at every alignment of the set
+#include "Cache.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+struct Matcher {
+    TagMatchKind kind;
+    bool supported;
+};
+
+static int failures = 0;
+static long long checks = 0;
+
+// The way the reference search finds, the lowest matching one, or -1
+static int expectedWay(const uint64_t* setTags, int ways, uint64_t tag) {
+    for (int way = 0; way < ways; way++) {
+        if (setTags[way] == tag) return way;
+    }
+    return -1;
+}
+
+static void check(const std::vector<Matcher>& matchers, const uint64_t* setTags, int ways, uint64_t tag) {
+    int expected = expectedWay(setTags, ways, tag);
+    for (const Matcher& matcher : matchers) {
+        if (!matcher.supported) continue;
+        int way = matchTag(matcher.kind, setTags, ways, tag);
+        checks++;
+        if (way != expected && failures++ < 10) {
+            std::cerr << "FAIL: " << tagMatchName(matcher.kind) << " E=" << ways << " tag=" << tag
+                      << ": way " << way << ", expected " << expected << std::endl;
+        }
+    }
+}
+
+int main() {
+    std::vector<Matcher> matchers = {
+        { TAG_MATCH_SCALAR, true },
+        { TAG_MATCH_SSE2, true },
+        { TAG_MATCH_AVX2, true },
+    };
+#if defined(__x86_64__) || defined(__i386__)
+    if (!__builtin_cpu_supports("avx2")) {
+        matchers[2].supported = false;
+        std::cout << "AVX2 not supported by this CPU, skipped" << std::endl;
+    }
+#endif
+
+    std::mt19937_64 rng(12345);
+    const uint64_t tagMask = ~(uint64_t)0 >> 1; // stored tags are block numbers, at most 63 bits
+    const int maxWays = 64;
+    std::vector<uint64_t> storage(maxWays + 4);
+
+    for (int ways = 1; ways <= maxWays; ways++) {
+        for (int trial = 0; trial < 200; trial++) {
+            // Sets start at any multiple of 8 bytes in the tag array
+            uint64_t* setTags = storage.data() + trial % 4;
+            for (int way = 0; way < ways; way++) {
+                uint64_t r = rng();
+                setTags[way] = (r % 4 == 0) ? INVALID_TAG : (rng() & tagMask);
+            }
+            if (trial % 3 == 0 && ways > 1) {
+                setTags[rng() % ways] = setTags[rng() % ways]; // duplicate tag
+            }
+            if (trial % 5 == 0) {
+                for (int way = 0; way < ways; way++) setTags[way] = INVALID_TAG; // empty set
+            }
+
+            for (int way = 0; way < ways; way++) {
+                uint64_t tag = setTags[way];
+                check(matchers, setTags, ways, tag);
+                if (tag != INVALID_TAG) {
+                    // Differing in only the low or the high 32 bits
+                    check(matchers, setTags, ways, tag ^ 1);
+                    check(matchers, setTags, ways, tag ^ ((uint64_t)1 << 40));
+                }
+            }
+            check(matchers, setTags, ways, rng() & tagMask);
+            check(matchers, setTags, ways, INVALID_TAG);
+            check(matchers, setTags, ways, 0);
+        }
+        // The same tag in every way
+        uint64_t* setTags = storage.data();
+        for (int way = 0; way < ways; way++) setTags[way] = 42;
+        check(matchers, setTags, ways, 42);
+        check(matchers, setTags, ways, 43);
+    }
+
+    if (failures > 0) {
+        std::cout << failures << " of " << checks << " tag matches differ from the scalar search" << std::endl;
+        return 1;
+    }
+    std::cout << "tag match: " << checks << " lookups agree (E = 1.." << maxWays << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Converts the text traces <prefix>_procN.trace into one binary <prefix>.l1bt file
+#include "TraceReader.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <getopt.h>
+#include <sys/stat.h>
+
+void printHelp() {
+    std::cout << "Usage: ./traceconv -t <tracefile> [-n <cores>] [-o <outfilename>] [-v] [-h]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -t <tracefile>: prefix of the text traces (e.g. app1 for app1_proc0.trace ...)" << std::endl;
+    std::cout << "  -n <cores>: number of cores to convert (default: every consecutive _procN file found)" << std::endl;
+    std::cout << "  -o <outfilename>: binary trace to write (default: <tracefile>.l1bt)" << std::endl;
+    std::cout << "  -v: decode the written file again and compare it with the text traces" << std::endl;
+    std::cout << "  -h: prints this help" << std::endl;
+}
+
+static long long fileSize(const std::string& fileName) {
+    struct stat st;
+    return stat(fileName.c_str(), &st) == 0 ? (long long)st.st_size : 0;
+}
+
+// Compares every record of the binary trace with the text trace it came from
+static bool verify(const std::string& prefix, const std::string& binaryName, int numCores) {
+    std::vector<std::unique_ptr<TraceSource> > decoded = openTraceSources(binaryName, numCores);
+    for (int i = 0; i < numCores; i++) {
+        TextTraceSource text(traceFileName(prefix, i));
+        const TraceRecord *a = nullptr, *b = nullptr;
+        size_t na = 0, nb = 0, ia = 0, ib = 0;
+        unsigned long long index = 0;
+        while (true) {
+            if (ia == na) { na = text.nextChunk(a); ia = 0; }
+            if (ib == nb) { nb = decoded[i]->nextChunk(b); ib = 0; }
+            if (na == 0 || nb == 0) {
+                if (na != nb) {
+                    std::cerr << "Core " << i << ": record count mismatch after " << index << " records" << std::endl;
+                    return false;
+                }
+                break;
+            }
+            if (a[ia].address != b[ib].address || a[ia].op != b[ib].op) {
+                std::cerr << "Core " << i << ": record " << index << " differs ("
+                          << recordToString(a[ia]) << " vs " << recordToString(b[ib]) << ")" << std::endl;
+                return false;
+            }
+            ia++; ib++; index++;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string prefix;
+    std::string outFileName;
+    int numCores = 0;
+    bool verifyOutput = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:o:vh")) != -1) {
+        switch (opt) {
+            case 't':
+                prefix = optarg;
+                break;
+            case 'n':
+                numCores = std::stoi(optarg);
+                break;
+            case 'o':
+                outFileName = optarg;
+                break;
+            case 'v':
+                verifyOutput = true;
+                break;
+            case 'h':
+                printHelp();
+                return 0;
+            default:
+                printHelp();
+                return 1;
+        }
+    }
+
+    if (prefix.empty()) {
+        std::cerr << "Error: Missing trace file prefix (-t)" << std::endl;
+        printHelp();
+        return 1;
+    }
+    if (outFileName.empty()) {
+        outFileName = prefix + BINARY_TRACE_EXTENSION;
+    }
+    if (numCores <= 0) {
+        numCores = countTextTraces(prefix);
+        if (numCores == 0) {
+            std::cerr << "Error: No trace files found for prefix " << prefix << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        std::vector<BinaryTraceEncoder> encoders(numCores);
+        long long textBytes = 0;
+        for (int i = 0; i < numCores; i++) {
+            std::string fileName = traceFileName(prefix, i);
+            TextTraceSource text(fileName);
+            const TraceRecord* chunk = nullptr;
+            size_t n;
+            while ((n = text.nextChunk(chunk)) > 0) {
+                for (size_t k = 0; k < n; k++) {
+                    encoders[i].append(chunk[k]);
+                }
+            }
+            textBytes += fileSize(fileName);
+        }
+        writeBinaryTrace(outFileName, encoders);
+
+        long long binaryBytes = fileSize(outFileName);
+        std::cout << "Wrote " << outFileName << ": " << numCores << " cores, "
+                  << binaryBytes << " bytes (" << textBytes << " bytes of text";
+        if (binaryBytes > 0) {
+            std::cout << ", " << (double)textBytes / binaryBytes << "x smaller";
+        }
+        std::cout << ")" << std::endl;
+
+        if (verifyOutput) {
+            if (!verify(prefix, outFileName, numCores)) {
+                return 1;
+            }
+            std::cout << "Verified against the text traces" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}